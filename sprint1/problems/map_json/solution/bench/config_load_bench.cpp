@@ -0,0 +1,225 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "../src/game_snapshot.h"
+#include "../src/json_loader.h"
+#include "../src/json_stream_loader.h"
+
+/*
+ * Замер времени старта: сколько занимает загрузка конфигурации и сколько памяти она требует.
+ * Генерирует синтетический конфиг заданного размера (или берёт готовый) и загружает его
+ * DOM-загрузчиком LoadGame (последовательно и на --threads потоках), потоковым StreamLoadGame
+ * и из двоичного снимка, который собирается из того же конфига.
+ * Каждая загрузка идёт в отдельном дочернем процессе, поэтому пиковое потребление памяти
+ * (max RSS) у них не смешивается.
+ */
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    struct Config {
+        fs::path config_path = fs::temp_directory_path() / "game_server_synthetic_config.json";
+        std::uint64_t size_mb = 500;
+        bool run_dom = true;
+        bool run_parallel = true;
+        bool run_stream = true;
+        bool run_snapshot = true;
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    };
+
+    // Элементов каждого вида на одной синтетической карте
+    constexpr unsigned ROADS_PER_MAP = 200;
+    constexpr unsigned BUILDINGS_PER_MAP = 100;
+    constexpr unsigned OFFICES_PER_MAP = 20;
+
+    // Пишет карты, пока файл не достигнет size_bytes. Содержимое детерминировано
+    void GenerateConfig(const fs::path& path, std::uint64_t size_bytes) {
+        std::ofstream out(path, std::ios::binary);
+        if (!out) {
+            throw std::runtime_error("Could not create "s + path.string());
+        }
+        std::mt19937 random{ 42 };
+        std::uniform_int_distribution<int> coord{ 0, 1000 };
+
+        out << "{\"maps\":[\n"sv;
+        for (unsigned map = 0; static_cast<std::uint64_t>(out.tellp()) < size_bytes; ++map) {
+            if (map != 0) {
+                out << ",\n"sv;
+            }
+            out << "{\"id\":\"map"sv << map << "\",\"name\":\"Synthetic map "sv << map << "\",\"roads\":["sv;
+            for (unsigned i = 0; i < ROADS_PER_MAP; ++i) {
+                out << (i == 0 ? ""sv : ","sv) << "{\"x0\":"sv << coord(random) << ",\"y0\":"sv << coord(random)
+                    << (i % 2 == 0 ? ",\"x1\":"sv : ",\"y1\":"sv) << coord(random) << '}';
+            }
+            out << "],\"buildings\":["sv;
+            for (unsigned i = 0; i < BUILDINGS_PER_MAP; ++i) {
+                out << (i == 0 ? ""sv : ","sv) << "{\"x\":"sv << coord(random) << ",\"y\":"sv << coord(random)
+                    << ",\"w\":"sv << coord(random) << ",\"h\":"sv << coord(random) << '}';
+            }
+            out << "],\"offices\":["sv;
+            for (unsigned i = 0; i < OFFICES_PER_MAP; ++i) {
+                out << (i == 0 ? ""sv : ","sv) << "{\"id\":\"o"sv << i << "\",\"x\":"sv << coord(random)
+                    << ",\"y\":"sv << coord(random) << ",\"offsetX\":5,\"offsetY\":0}"sv;
+            }
+            out << "]}"sv;
+        }
+        out << "\n]}\n"sv;
+        if (!out) {
+            throw std::runtime_error("Could not write "s + path.string());
+        }
+    }
+
+    struct LoadResult {
+        double seconds = 0;
+        std::uint64_t maps = 0;
+        long max_rss_kb = 0;
+    };
+
+    // Загружает конфиг в дочернем процессе. Время и число карт передаются через pipe, память - через wait4
+    LoadResult MeasureInChild(const std::function<model::Game(const fs::path&)>& load, const fs::path& path) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            throw std::runtime_error("pipe failed");
+        }
+        const pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("fork failed");
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            LoadResult result;
+            try {
+                const auto start = Clock::now();
+                const auto game = load(path);
+                result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                result.maps = game.GetMaps().size();
+            }
+            catch (const std::exception& ex) {
+                std::cerr << ex.what() << std::endl;
+                _exit(EXIT_FAILURE);
+            }
+            const bool written = write(fds[1], &result, sizeof(result)) == static_cast<ssize_t>(sizeof(result));
+            _exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        close(fds[1]);
+        LoadResult result;
+        const bool received = read(fds[0], &result, sizeof(result)) == static_cast<ssize_t>(sizeof(result));
+        close(fds[0]);
+
+        int status = 0;
+        rusage usage{};
+        wait4(pid, &status, 0, &usage);
+        if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            throw std::runtime_error("Loader process failed");
+        }
+        result.max_rss_kb = usage.ru_maxrss;
+        return result;
+    }
+
+    void PrintResult(std::string_view loader, const LoadResult& result) {
+        std::cout << std::left << std::setw(10) << loader << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << result.seconds << " s"sv
+            << std::setw(10) << result.maps << " maps"sv
+            << std::setw(10) << result.max_rss_kb / 1024 << " MiB max RSS"sv << std::endl;
+    }
+
+    Config ParseCommandLine(int argc, const char* argv[]) {
+        Config config;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view option = argv[i];
+            if (i + 1 == argc) {
+                throw std::invalid_argument("Missing value for "s + std::string{ option });
+            }
+            const std::string_view value = argv[++i];
+
+            if (option == "--config"sv) {
+                config.config_path = value;
+            }
+            else if (option == "--size-mb"sv) {
+                const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), config.size_mb);
+                if (ec != std::errc{} || end != value.data() + value.size() || config.size_mb == 0) {
+                    throw std::invalid_argument("Invalid value for --size-mb: "s + std::string{ value });
+                }
+            }
+            else if (option == "--loader"sv) {
+                config.run_dom = value == "dom"sv || value == "all"sv;
+                config.run_parallel = value == "parallel"sv || value == "all"sv;
+                config.run_stream = value == "stream"sv || value == "all"sv;
+                config.run_snapshot = value == "snapshot"sv || value == "all"sv;
+                if (!config.run_dom && !config.run_parallel && !config.run_stream && !config.run_snapshot) {
+                    throw std::invalid_argument("--loader must be dom, parallel, stream, snapshot or all");
+                }
+            }
+            else if (option == "--threads"sv) {
+                const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), config.threads);
+                if (ec != std::errc{} || end != value.data() + value.size() || config.threads == 0) {
+                    throw std::invalid_argument("Invalid value for --threads: "s + std::string{ value });
+                }
+            }
+            else {
+                throw std::invalid_argument("Unknown option "s + std::string{ option });
+            }
+        }
+        return config;
+    }
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        const Config config = ParseCommandLine(argc, argv);
+
+        // Готовый файл переиспользуется: генерация 500 МБ занимает заметное время
+        if (!fs::exists(config.config_path)) {
+            std::cout << "Generating "sv << config.size_mb << " MB config at "sv << config.config_path.string() << std::endl;
+            GenerateConfig(config.config_path, config.size_mb * 1024 * 1024);
+        }
+        std::cout << "Config: "sv << config.config_path.string() << ", "sv
+            << fs::file_size(config.config_path) / (1024 * 1024) << " MiB"sv << std::endl;
+
+        if (config.run_dom) {
+            PrintResult("dom"sv, MeasureInChild([](const fs::path& path) { return json_loader::LoadGame{}(path); }, config.config_path));
+        }
+        if (config.run_parallel) {
+            const unsigned threads = config.threads;
+            PrintResult("parallel"sv, MeasureInChild([threads](const fs::path& path) { return json_loader::LoadGame{ threads }(path); }, config.config_path));
+        }
+        if (config.run_stream) {
+            PrintResult("stream"sv, MeasureInChild([](const fs::path& path) { return json_loader::StreamLoadGame{}(path); }, config.config_path));
+        }
+        if (config.run_snapshot) {
+            auto snapshot_path = config.config_path;
+            snapshot_path += ".snapshot"sv;
+            // Снимок, собранный из прежней версии конфига, пересобирается
+            if (!fs::exists(snapshot_path) || fs::last_write_time(snapshot_path) < fs::last_write_time(config.config_path)) {
+                game_snapshot::WriteSnapshot(json_loader::StreamLoadGame{}(config.config_path), snapshot_path);
+            }
+            PrintResult("snapshot"sv, MeasureInChild([](const fs::path& path) { return game_snapshot::LoadSnapshot(path); }, snapshot_path));
+        }
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << "Usage: config_load_bench [--config PATH] [--size-mb N] [--loader dom|parallel|stream|snapshot|all] [--threads N]"sv << std::endl;
+        return EXIT_FAILURE;
+    }
+}
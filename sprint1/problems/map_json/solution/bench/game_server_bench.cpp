@@ -0,0 +1,583 @@
+#include "../src/sdk.h"
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "../src/latency_histogram.h"
+#include "../src/model.h"
+#include "../src/session_arena.h"
+#include "../src/shared_buffer_body.h"
+
+/*
+ * Нагрузочный клиент для game_server.
+ * Открывает заданное число keep-alive соединений к уже запущенному серверу и в течение заданного
+ * времени отправляет взвешенную смесь запросов GET /api/v1/maps и GET /api/v1/maps/{id}.
+ * Каждое соединение держит в полёте до --pipeline запросов. По окончании печатает пропускную
+ * способность и распределение задержек (p50/p99/p999 и таблицу перцентилей как у HdrHistogram).
+ *
+ * --mode alloc вместо нагрузки на сервер считает в этом процессе выделения памяти на один запрос
+ * при размещении заголовков обычным аллокатором и в арене сессии. --mode lookup сравнивает поиск
+ * карт и офисов по готовому id и по строке из пути запроса. Этим режимам сервер не нужен.
+ */
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace json = boost::json;
+namespace sys = boost::system;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    // Вызовы operator new во всём процессе. Счётчик нужен режиму alloc, остальным он не мешает
+    std::atomic<std::uint64_t> allocation_count{ 0 };
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+// noinline: встроенный free рядом с new-выражением GCC принимает за несовпадение new/delete
+[[gnu::noinline]] void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+    constexpr std::string_view MAPS_URL = "/api/v1/maps"sv;
+
+    constexpr std::string_view LOAD_MODE = "load"sv;
+    constexpr std::string_view ALLOC_MODE = "alloc"sv;
+    constexpr std::string_view LOOKUP_MODE = "lookup"sv;
+
+    struct Config {
+        std::string mode{ LOAD_MODE };
+        std::string host = "127.0.0.1";
+        std::string port = "8080";
+        unsigned connections = 64;
+        unsigned threads = 1;
+        unsigned pipeline = 1;
+        std::chrono::seconds duration{ 10 };
+        std::chrono::seconds warmup{ 2 };
+        unsigned list_weight = 1;
+        unsigned map_weight = 9;
+        unsigned iterations = 100'000; // для режимов, работающих без сервера
+    };
+
+    // Статистика одного соединения. Соединения не делят её между собой, слияние - после остановки
+    struct Stats {
+        metrics::LatencyHistogram latency; // в микросекундах
+        std::uint64_t responses = 0;
+        std::uint64_t non_ok = 0;
+        std::uint64_t errors = 0;
+    };
+
+    // Набор целей запросов и их весов. Общий для всех соединений и после создания не меняется
+    class Workload {
+    public:
+        Workload(const Config& config, const std::vector<std::string>& map_ids)
+            : map_targets_{ MakeMapTargets(map_ids) }
+            , list_probability_{ map_targets_.empty() ? 1.0
+                : static_cast<double>(config.list_weight) / static_cast<double>(config.list_weight + config.map_weight) } {
+        }
+
+        template <typename Random>
+        std::string_view NextTarget(Random& random) const {
+            if (std::uniform_real_distribution<double>{ 0.0, 1.0 }(random) < list_probability_) {
+                return MAPS_URL;
+            }
+            return map_targets_[std::uniform_int_distribution<std::size_t>{ 0, map_targets_.size() - 1 }(random)];
+        }
+
+    private:
+        static std::vector<std::string> MakeMapTargets(const std::vector<std::string>& map_ids) {
+            std::vector<std::string> targets;
+            targets.reserve(map_ids.size());
+            for (const auto& id : map_ids) {
+                targets.push_back(std::string{ MAPS_URL } + "/"s + id);
+            }
+            return targets;
+        }
+
+        std::vector<std::string> map_targets_;
+        double list_probability_;
+    };
+
+    class Connection : public std::enable_shared_from_this<Connection> {
+    public:
+        Connection(net::io_context& ioc, const Config& config, const Workload& workload,
+            Clock::time_point record_from, Clock::time_point stop_at, unsigned seed)
+            : socket_{ net::make_strand(ioc) }
+            , config_{ config }
+            , workload_{ workload }
+            , random_{ seed }
+            , record_from_{ record_from }
+            , stop_at_{ stop_at } {
+        }
+
+        void Run(const tcp::resolver::results_type& endpoints) {
+            net::async_connect(socket_, endpoints,
+                [self = shared_from_this()](sys::error_code ec, const tcp::endpoint&) {
+                    if (ec) {
+                        ++self->stats_.errors;
+                        return;
+                    }
+                    self->socket_.set_option(tcp::no_delay(true), ec);
+                    self->SendBatch();
+                });
+        }
+
+        const Stats& GetStats() const noexcept {
+            return stats_;
+        }
+
+    private:
+        // Отправляет config_.pipeline запросов одной записью и ждёт ответы на все них
+        void SendBatch() {
+            if (Clock::now() >= stop_at_) {
+                sys::error_code ec;
+                socket_.shutdown(tcp::socket::shutdown_both, ec);
+                return;
+            }
+
+            out_.clear();
+            for (unsigned i = 0; i < config_.pipeline; ++i) {
+                out_ += "GET "sv;
+                out_ += workload_.NextTarget(random_);
+                out_ += " HTTP/1.1\r\nHost: "sv;
+                out_ += config_.host;
+                out_ += "\r\n\r\n"sv;
+            }
+            in_flight_ = config_.pipeline;
+            sent_at_ = Clock::now();
+
+            net::async_write(socket_, net::buffer(out_),
+                [self = shared_from_this()](sys::error_code ec, std::size_t) {
+                    if (ec) {
+                        ++self->stats_.errors;
+                        return;
+                    }
+                    self->ReadResponse();
+                });
+        }
+
+        void ReadResponse() {
+            response_ = {};
+            http::async_read(socket_, buffer_, response_,
+                [self = shared_from_this()](sys::error_code ec, std::size_t) {
+                    self->OnResponse(ec);
+                });
+        }
+
+        void OnResponse(sys::error_code ec) {
+            if (ec) {
+                ++stats_.errors;
+                return;
+            }
+
+            // Задержка считается от момента отправки пакета, в котором ушёл запрос
+            const auto now = Clock::now();
+            if (sent_at_ >= record_from_) {
+                const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - sent_at_);
+                stats_.latency.Record(static_cast<std::uint64_t>(latency.count()));
+                ++stats_.responses;
+                if (response_.result() != http::status::ok) {
+                    ++stats_.non_ok;
+                }
+            }
+
+            if (--in_flight_ != 0) {
+                return ReadResponse();
+            }
+            if (response_.need_eof()) {
+                return;
+            }
+            SendBatch();
+        }
+
+    private:
+        tcp::socket socket_;
+        const Config& config_;
+        const Workload& workload_;
+        std::minstd_rand random_;
+        Clock::time_point record_from_;
+        Clock::time_point stop_at_;
+
+        std::string out_;
+        beast::flat_buffer buffer_;
+        http::response<http::string_body> response_;
+        unsigned in_flight_ = 0;
+        Clock::time_point sent_at_;
+        Stats stats_;
+    };
+
+    // Синхронно запрашивает список карт, чтобы знать, какие /api/v1/maps/{id} существуют
+    std::vector<std::string> FetchMapIds(net::io_context& ioc, const tcp::resolver::results_type& endpoints, const Config& config) {
+        tcp::socket socket{ ioc };
+        net::connect(socket, endpoints);
+
+        http::request<http::empty_body> request{ http::verb::get, MAPS_URL, 11 };
+        request.set(http::field::host, config.host);
+        http::write(socket, request);
+
+        beast::flat_buffer buffer;
+        http::response<http::string_body> response;
+        http::read(socket, buffer, response);
+        if (response.result() != http::status::ok) {
+            throw std::runtime_error("GET "s + std::string{ MAPS_URL } + " returned "s + std::to_string(response.result_int()));
+        }
+
+        std::vector<std::string> ids;
+        for (const auto& map : json::parse(response.body()).as_array()) {
+            const auto& id = map.as_object().at("id").as_string();
+            ids.emplace_back(id.begin(), id.end());
+        }
+        return ids;
+    }
+
+    unsigned ParseUnsigned(std::string_view name, std::string_view value) {
+        unsigned result = 0;
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+        if (ec != std::errc{} || end != value.data() + value.size()) {
+            throw std::invalid_argument("Invalid value for "s + std::string{ name } + ": "s + std::string{ value });
+        }
+        return result;
+    }
+
+    Config ParseCommandLine(int argc, const char* argv[]) {
+        Config config;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view option = argv[i];
+            if (i + 1 == argc) {
+                throw std::invalid_argument("Missing value for "s + std::string{ option });
+            }
+            const std::string_view value = argv[++i];
+
+            if (option == "--host"sv) {
+                config.host = value;
+            }
+            else if (option == "--port"sv) {
+                config.port = value;
+            }
+            else if (option == "--connections"sv) {
+                config.connections = ParseUnsigned(option, value);
+            }
+            else if (option == "--threads"sv) {
+                config.threads = ParseUnsigned(option, value);
+            }
+            else if (option == "--pipeline"sv) {
+                config.pipeline = ParseUnsigned(option, value);
+            }
+            else if (option == "--duration"sv) {
+                config.duration = std::chrono::seconds{ ParseUnsigned(option, value) };
+            }
+            else if (option == "--warmup"sv) {
+                config.warmup = std::chrono::seconds{ ParseUnsigned(option, value) };
+            }
+            else if (option == "--list-weight"sv) {
+                config.list_weight = ParseUnsigned(option, value);
+            }
+            else if (option == "--map-weight"sv) {
+                config.map_weight = ParseUnsigned(option, value);
+            }
+            else if (option == "--mode"sv) {
+                if (value != LOAD_MODE && value != ALLOC_MODE && value != LOOKUP_MODE) {
+                    throw std::invalid_argument("Unknown mode "s + std::string{ value });
+                }
+                config.mode = value;
+            }
+            else if (option == "--iterations"sv) {
+                config.iterations = ParseUnsigned(option, value);
+            }
+            else {
+                throw std::invalid_argument("Unknown option "s + std::string{ option });
+            }
+        }
+
+        if (config.connections == 0 || config.threads == 0 || config.pipeline == 0 || config.iterations == 0) {
+            throw std::invalid_argument("--connections, --threads, --pipeline and --iterations must be positive");
+        }
+        if (config.list_weight == 0 && config.map_weight == 0) {
+            throw std::invalid_argument("At least one of --list-weight and --map-weight must be positive");
+        }
+        return config;
+    }
+
+    // Запрос с заголовками, как у типичного клиента
+    constexpr std::string_view SAMPLE_REQUEST = "GET /api/v1/maps/map1 HTTP/1.1\r\n"
+        "Host: 127.0.0.1:8080\r\n"
+        "User-Agent: game_server_bench\r\n"
+        "Accept: application/json\r\n"
+        "\r\n"sv;
+
+    /*
+     * То, что сессия делает с заголовками одного запроса, без сокета: разбор запроса, сборка
+     * ответа с телом из кэша и сериализация его заголовка. Allocator - аллокатор полей заголовков.
+     * Возвращает размер заголовка ответа, чтобы компилятор не выбросил работу
+     */
+    template <typename Allocator>
+    std::size_t HandleSampleRequest(const Allocator& allocator, const http_server::SharedBuffer& body) {
+        http::request_parser<http::string_body, Allocator> parser(std::piecewise_construct, std::make_tuple(), std::make_tuple(allocator));
+        parser.eager(true);
+        beast::error_code ec;
+        parser.put(net::buffer(SAMPLE_REQUEST), ec);
+        if (ec || !parser.is_done()) {
+            throw std::logic_error("Could not parse the sample request");
+        }
+        const auto& request = parser.get();
+
+        http::response<http_server::SharedBufferBody, http::basic_fields<Allocator>> response(
+            std::piecewise_construct, std::make_tuple(), std::make_tuple(allocator));
+        response.result(http::status::ok);
+        response.version(request.version());
+        response.set(http::field::content_type, "application/json"sv);
+        response.set(http::field::etag, "\"5d41402abc4b2a76\""sv);
+        response.body() = body;
+        response.content_length(body->size());
+        response.keep_alive(request.keep_alive());
+
+        typename http::basic_fields<Allocator>::writer header{ response.base(), response.version(), response.result_int() };
+        return net::buffer_size(header.get());
+    }
+
+    // Средние выделения памяти и время одной операции
+    struct OperationCost {
+        double allocations = 0;
+        double nanoseconds = 0;
+    };
+
+    // operation() выполняет одну операцию и возвращает число, зависящее от её результата, - чтобы
+    // компилятор не выбросил работу. Первый вызов - прогрев, он не учитывается
+    template <typename Operation>
+    OperationCost MeasureOperations(unsigned iterations, Operation&& operation) {
+        std::size_t checksum = operation();
+        const auto allocations_before = allocation_count.load(std::memory_order_relaxed);
+        const auto start = Clock::now();
+        for (unsigned i = 0; i < iterations; ++i) {
+            checksum += operation();
+        }
+        const auto elapsed = Clock::now() - start;
+        const auto allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+        [[maybe_unused]] volatile std::size_t sink = checksum;
+        return {
+            static_cast<double>(allocations) / iterations,
+            static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / iterations
+        };
+    }
+
+    /*
+     * Выделения памяти на заголовки одного запроса и ответа: с полями на std::allocator (как было
+     * до арены) и в арене сессии, которая сбрасывается между запросами, как в SessionBase::Read.
+     * Выделения Asio и Beast на асинхронные операции сокета сюда не входят - они одинаковы в обоих случаях
+     */
+    void RunAllocationBenchmark(const Config& config) {
+        const auto body = http_server::MakeSharedBuffer(std::string(2048, 'x'));
+
+        const auto heap = MeasureOperations(config.iterations, [&body] {
+            return HandleSampleRequest(std::allocator<char>{}, body);
+            });
+
+        http_server::SessionArena arena;
+        const auto arena_cost = MeasureOperations(config.iterations, [&body, &arena] {
+            const auto header_bytes = HandleSampleRequest(arena.GetAllocator(), body);
+            arena.Reset();
+            return header_bytes;
+            });
+
+        std::cout << "Header allocations per request over "sv << config.iterations << " requests"sv << std::endl;
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "  std::allocator: "sv << heap.allocations << " allocs, "sv << heap.nanoseconds << " ns"sv << std::endl;
+        std::cout << "  session arena:  "sv << arena_cost.allocations << " allocs, "sv << arena_cost.nanoseconds << " ns"sv << std::endl;
+    }
+
+    // Число карт и офисов на карте в синтетической игре режима lookup
+    constexpr unsigned LOOKUP_MAPS = 64;
+    constexpr unsigned LOOKUP_OFFICES = 32;
+
+    // Id длиннее буфера SSO std::string: создание Map::Id или Office::Id из них выделяет память
+    std::string MakeLookupId(std::string_view kind, unsigned index) {
+        return std::string{ kind } + "-identifier-"s + std::to_string(index);
+    }
+
+    model::Game MakeLookupGame() {
+        model::Game game;
+        game.ReserveMaps(LOOKUP_MAPS);
+        for (unsigned i = 0; i < LOOKUP_MAPS; ++i) {
+            model::Map map{ model::Map::Id{ MakeLookupId("map"sv, i) }, "Map "s + std::to_string(i) };
+            map.AddRoad({ model::Road::HORIZONTAL, { 0, 0 }, 100 });
+            for (unsigned j = 0; j < LOOKUP_OFFICES; ++j) {
+                map.AddOffice({ model::Office::Id{ MakeLookupId("office"sv, j) }, { static_cast<model::Coord>(j), 0 }, { 0, 0 } });
+            }
+            game.AddMap(std::move(map));
+        }
+        return game;
+    }
+
+    /*
+     * Поиск карт и офисов по строкам, как они приходят в пути запроса. Сравнивается поиск через
+     * временный Map::Id (Office::Id) и прямой поиск по std::string_view. Каждая пятая строка -
+     * несуществующий id, чтобы учитывались и промахи.
+     */
+    void RunLookupBenchmark(const Config& config) {
+        const model::Game game = MakeLookupGame();
+        const model::Map& map = game.GetMaps().front();
+
+        std::vector<std::string> map_ids;
+        std::vector<std::string> office_ids;
+        for (unsigned i = 0; i < 5 * LOOKUP_MAPS / 4; ++i) {
+            map_ids.push_back(MakeLookupId("map"sv, i));
+        }
+        for (unsigned i = 0; i < 5 * LOOKUP_OFFICES / 4; ++i) {
+            office_ids.push_back(MakeLookupId("office"sv, i));
+        }
+
+        // find(id) возвращает указатель на найденное или nullptr
+        auto measure = [&config](const std::vector<std::string>& ids, auto&& find) {
+            return MeasureOperations(config.iterations, [&ids, &find, i = std::size_t{ 0 }]() mutable -> std::size_t {
+                return find(std::string_view{ ids[i++ % ids.size()] }) != nullptr;
+                });
+        };
+
+        const auto map_by_id = measure(map_ids, [&game](std::string_view id) {
+            return game.FindMap(model::Map::Id{ std::string{ id } });
+            });
+        const auto map_by_view = measure(map_ids, [&game](std::string_view id) {
+            return game.FindMap(id);
+            });
+        const auto office_by_id = measure(office_ids, [&map](std::string_view id) {
+            const model::Office::Id office_id{ std::string{ id } };
+            return map.FindOffice(*office_id);
+            });
+        const auto office_by_view = measure(office_ids, [&map](std::string_view id) {
+            return map.FindOffice(id);
+            });
+
+        std::cout << "Lookups by a path segment over "sv << config.iterations << " lookups"sv << std::endl;
+        std::cout << std::fixed << std::setprecision(2);
+        for (const auto& [name, cost] : {
+            std::pair{ "FindMap(Map::Id)           "sv, map_by_id },
+            std::pair{ "FindMap(string_view)       "sv, map_by_view },
+            std::pair{ "FindOffice(via Office::Id) "sv, office_by_id },
+            std::pair{ "FindOffice(string_view)    "sv, office_by_view } }) {
+            std::cout << "  "sv << name << cost.allocations << " allocs, "sv << cost.nanoseconds << " ns"sv << std::endl;
+        }
+    }
+
+    void PrintReport(const Config& config, const Stats& total) {
+        const double seconds = std::chrono::duration<double>(config.duration).count();
+        const auto& latency = total.latency;
+
+        std::cout << "Connections: "sv << config.connections << ", pipeline: "sv << config.pipeline
+            << ", duration: "sv << config.duration.count() << "s (+"sv << config.warmup.count() << "s warmup)"sv << std::endl;
+        std::cout << "Responses: "sv << total.responses << ", non-200: "sv << total.non_ok
+            << ", errors: "sv << total.errors << std::endl;
+        std::cout << "Throughput: "sv << std::fixed << std::setprecision(1)
+            << static_cast<double>(total.responses) / seconds << " req/s"sv << std::endl;
+        std::cout << "Latency (us): p50="sv << latency.ValueAtPercentile(50)
+            << " p99="sv << latency.ValueAtPercentile(99)
+            << " p999="sv << latency.ValueAtPercentile(99.9)
+            << " max="sv << latency.GetMax() << std::endl;
+
+        // Таблица перцентилей в формате HdrHistogram: шаг к 100% каждый раз уменьшается вдвое
+        std::cout << std::endl << std::setw(12) << "Value(us)"sv << std::setw(14) << "Percentile"sv
+            << std::setw(18) << "1/(1-Percentile)"sv << std::endl;
+        for (double remaining = 1.0; remaining >= 1e-6; remaining /= 2) {
+            const double percentile = 100.0 * (1.0 - remaining);
+            std::cout << std::setw(12) << latency.ValueAtPercentile(percentile)
+                << std::setw(14) << std::setprecision(6) << percentile / 100.0
+                << std::setw(18) << std::setprecision(2) << 1.0 / remaining << std::endl;
+        }
+        std::cout << std::setw(12) << latency.GetMax() << std::setw(14) << std::setprecision(6) << 1.0 << std::setw(18) << "inf"sv << std::endl;
+    }
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        const Config config = ParseCommandLine(argc, argv);
+        if (config.mode == ALLOC_MODE) {
+            RunAllocationBenchmark(config);
+            return EXIT_SUCCESS;
+        }
+        if (config.mode == LOOKUP_MODE) {
+            RunLookupBenchmark(config);
+            return EXIT_SUCCESS;
+        }
+
+        net::io_context ioc(static_cast<int>(config.threads));
+        const auto endpoints = tcp::resolver{ ioc }.resolve(config.host, config.port);
+        const Workload workload{ config, FetchMapIds(ioc, endpoints, config) };
+
+        const auto record_from = Clock::now() + config.warmup;
+        const auto stop_at = record_from + config.duration;
+
+        std::vector<std::shared_ptr<Connection>> connections;
+        connections.reserve(config.connections);
+        for (unsigned i = 0; i < config.connections; ++i) {
+            connections.push_back(std::make_shared<Connection>(ioc, config, workload, record_from, stop_at, i + 1));
+            connections.back()->Run(endpoints);
+        }
+
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(config.threads - 1);
+            for (unsigned i = 1; i < config.threads; ++i) {
+                workers.emplace_back([&ioc] { ioc.run(); });
+            }
+            ioc.run();
+        }
+
+        Stats total;
+        for (const auto& connection : connections) {
+            const auto& stats = connection->GetStats();
+            total.latency.Merge(stats.latency);
+            total.responses += stats.responses;
+            total.non_ok += stats.non_ok;
+            total.errors += stats.errors;
+        }
+        PrintReport(config, total);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << "Usage: game_server_bench [--host H] [--port P] [--connections N] [--threads N] [--pipeline N]"sv
+            << " [--duration S] [--warmup S] [--list-weight W] [--map-weight W]"sv << std::endl;
+        std::cerr << "       game_server_bench --mode "sv << ALLOC_MODE << "|"sv << LOOKUP_MODE << " [--iterations N]"sv << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,343 @@
+#include "game_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace game_snapshot {
+    using namespace model;
+    using namespace std::literals;
+
+    namespace {
+        constexpr std::array<char, 8> MAGIC = { 'G', 'S', 'S', 'N', 'A', 'P', '\0', '\0' };
+        constexpr std::uint32_t FORMAT_VERSION = 1;
+        // Записывается как есть: при чтении на машине с другим порядком байт значение не совпадёт
+        constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        struct Header {
+            std::array<char, 8> magic;
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint32_t map_count;
+            std::uint32_t road_count;
+            std::uint32_t building_count;
+            std::uint32_t office_count;
+            std::uint32_t strings_size;
+            std::uint32_t checksum; // CRC-32 всех байтов после заголовка
+        };
+
+        // Строка - отрезок общего блока строк
+        struct StringRef {
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+        // Элементы карты - отрезки [first, first + count) соответствующих массивов
+        struct MapRecord {
+            StringRef id;
+            StringRef name;
+            std::uint32_t first_road;
+            std::uint32_t road_count;
+            std::uint32_t first_building;
+            std::uint32_t building_count;
+            std::uint32_t first_office;
+            std::uint32_t office_count;
+        };
+
+        struct RoadRecord {
+            std::int32_t x0, y0, x1, y1;
+        };
+
+        struct BuildingRecord {
+            std::int32_t x, y, w, h;
+        };
+
+        struct OfficeRecord {
+            StringRef id;
+            std::int32_t x, y, offset_x, offset_y;
+        };
+
+        // Массивы идут друг за другом без выравнивающих вставок, поэтому все записи кратны 4 байтам
+        template <typename... Records>
+        constexpr bool ARE_PACKED_RECORDS = ((std::is_trivially_copyable_v<Records> && sizeof(Records) % 4 == 0) && ...);
+        static_assert(ARE_PACKED_RECORDS<Header, MapRecord, RoadRecord, BuildingRecord, OfficeRecord>);
+
+        std::uint32_t CheckedSize(size_t size) {
+            if (size > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("Game is too large for a snapshot");
+            }
+            return static_cast<std::uint32_t>(size);
+        }
+
+        template <typename Record>
+        void AppendRecords(std::string& out, const std::vector<Record>& records) {
+            out.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+        }
+
+        std::uint32_t Checksum(const char* data, size_t size) {
+            boost::crc_32_type crc;
+            crc.process_bytes(data, size);
+            return crc.checksum();
+        }
+
+        // Сбрасывает на диск данные файла или, с O_DIRECTORY, записи каталога. Без этого после сбоя
+        // питания под именем снимка может оказаться пустой или недописанный файл
+        void SyncToDisk(const std::filesystem::path& path, int flags = 0) {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | flags);
+            if (fd < 0) {
+                throw std::runtime_error("Could not open "s + path.string());
+            }
+            const bool synced = ::fsync(fd) == 0;
+            ::close(fd);
+            if (!synced) {
+                throw std::runtime_error("Could not sync "s + path.string());
+            }
+        }
+
+        // Файл, отображённый в память только для чтения
+        class MappedFile {
+        public:
+            explicit MappedFile(const std::filesystem::path& path) {
+                const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) {
+                    throw std::invalid_argument("Could not open file!");
+                }
+                struct stat st {};
+                if (::fstat(fd, &st) != 0) {
+                    ::close(fd);
+                    throw std::runtime_error("Could not stat "s + path.string());
+                }
+                size_ = static_cast<size_t>(st.st_size);
+                if (size_ > 0) {
+                    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (data == MAP_FAILED) {
+                        ::close(fd);
+                        throw std::runtime_error("Could not map "s + path.string());
+                    }
+                    data_ = static_cast<const char*>(data);
+                    // Файл читается целиком, просим ядро подгрузить его заранее
+                    ::madvise(data, size_, MADV_WILLNEED);
+                }
+                ::close(fd);
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            ~MappedFile() {
+                if (data_ != nullptr) {
+                    ::munmap(const_cast<char*>(data_), size_);
+                }
+            }
+
+            std::string_view GetData() const noexcept {
+                return { data_, size_ };
+            }
+
+        private:
+            const char* data_ = nullptr;
+            size_t size_ = 0;
+        };
+
+        // Читатель массивов снимка. Каждый отрезок проверяется на выход за границы файла
+        class SnapshotReader {
+        public:
+            explicit SnapshotReader(std::string_view data)
+                : data_{ data } {
+            }
+
+            template <typename Record>
+            std::span<const Record> ReadArray(size_t count) {
+                if (count > (data_.size() - offset_) / sizeof(Record)) {
+                    throw std::invalid_argument("Snapshot is truncated");
+                }
+                // mmap возвращает адрес, выровненный по странице, а смещения кратны 4 байтам
+                const auto* records = reinterpret_cast<const Record*>(data_.data() + offset_);
+                offset_ += count * sizeof(Record);
+                return { records, count };
+            }
+
+            std::string_view ReadBytes(size_t size) {
+                if (size > data_.size() - offset_) {
+                    throw std::invalid_argument("Snapshot is truncated");
+                }
+                const auto bytes = data_.substr(offset_, size);
+                offset_ += size;
+                return bytes;
+            }
+
+            bool AtEnd() const noexcept {
+                return offset_ == data_.size();
+            }
+
+        private:
+            std::string_view data_;
+            size_t offset_ = 0;
+        };
+
+        template <typename Record>
+        std::span<const Record> Slice(std::span<const Record> records, std::uint32_t first, std::uint32_t count) {
+            if (first > records.size() || count > records.size() - first) {
+                throw std::invalid_argument("Snapshot record is out of range");
+            }
+            return records.subspan(first, count);
+        }
+
+        std::string_view GetString(std::string_view strings, StringRef ref) {
+            if (ref.offset > strings.size() || ref.size > strings.size() - ref.offset) {
+                throw std::invalid_argument("Snapshot string is out of range");
+            }
+            return strings.substr(ref.offset, ref.size);
+        }
+    }  // namespace
+
+    void WriteSnapshot(const Game& game, const std::filesystem::path& path) {
+        std::vector<MapRecord> maps;
+        std::vector<RoadRecord> roads;
+        std::vector<BuildingRecord> buildings;
+        std::vector<OfficeRecord> offices;
+        std::string strings;
+
+        const auto add_string = [&strings](std::string_view value) {
+            const StringRef ref{ CheckedSize(strings.size()), CheckedSize(value.size()) };
+            strings.append(value);
+            return ref;
+        };
+
+        maps.reserve(game.GetMaps().size());
+        for (const auto& map : game.GetMaps()) {
+            MapRecord& record = maps.emplace_back();
+            record.id = add_string(*map.GetId());
+            record.name = add_string(map.GetName());
+
+            record.first_road = CheckedSize(roads.size());
+            record.road_count = CheckedSize(map.GetRoads().size());
+            for (const auto& road : map.GetRoads()) {
+                roads.push_back({ road.GetStart().x, road.GetStart().y, road.GetEnd().x, road.GetEnd().y });
+            }
+
+            record.first_building = CheckedSize(buildings.size());
+            record.building_count = CheckedSize(map.GetBuildings().size());
+            for (const auto& building : map.GetBuildings()) {
+                const auto& bounds = building.GetBounds();
+                buildings.push_back({ bounds.position.x, bounds.position.y, bounds.size.width, bounds.size.height });
+            }
+
+            record.first_office = CheckedSize(offices.size());
+            record.office_count = CheckedSize(map.GetOffices().size());
+            for (const auto& office : map.GetOffices()) {
+                offices.push_back({ add_string(*office.GetId()), office.GetPosition().x, office.GetPosition().y,
+                                    office.GetOffset().dx, office.GetOffset().dy });
+            }
+        }
+
+        std::string payload;
+        AppendRecords(payload, maps);
+        AppendRecords(payload, roads);
+        AppendRecords(payload, buildings);
+        AppendRecords(payload, offices);
+        payload.append(strings);
+
+        const Header header{
+            MAGIC, FORMAT_VERSION, BYTE_ORDER_MARK,
+            CheckedSize(maps.size()), CheckedSize(roads.size()), CheckedSize(buildings.size()), CheckedSize(offices.size()),
+            CheckedSize(strings.size()), Checksum(payload.data(), payload.size())
+        };
+
+        auto temp_path = path;
+        temp_path += ".tmp"sv;
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+            if (!out.flush()) {
+                throw std::runtime_error("Could not write "s + temp_path.string());
+            }
+        }
+        // Переименование заменяет старый снимок, только когда новый уже целиком на диске
+        SyncToDisk(temp_path);
+        std::filesystem::rename(temp_path, path);
+        const auto directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path{ "."sv };
+        SyncToDisk(directory, O_DIRECTORY);
+    }
+
+    bool IsSnapshot(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::array<char, MAGIC.size()> magic{};
+        return in.read(magic.data(), magic.size()) && magic == MAGIC;
+    }
+
+    Game LoadSnapshot(const std::filesystem::path& path) {
+        const MappedFile file{ path };
+        SnapshotReader reader{ file.GetData() };
+
+        const Header header = reader.ReadArray<Header>(1).front();
+        if (header.magic != MAGIC) {
+            throw std::invalid_argument("Not a game snapshot");
+        }
+        if (header.byte_order != BYTE_ORDER_MARK) {
+            throw std::invalid_argument("Snapshot was written on a machine with a different byte order");
+        }
+        if (header.version != FORMAT_VERSION) {
+            throw std::invalid_argument("Unsupported snapshot version "s + std::to_string(header.version) +
+                                        ", rebuild it with --compile-config"s);
+        }
+        const auto payload = file.GetData().substr(sizeof(Header));
+        if (Checksum(payload.data(), payload.size()) != header.checksum) {
+            throw std::invalid_argument("Snapshot checksum mismatch");
+        }
+
+        const auto maps = reader.ReadArray<MapRecord>(header.map_count);
+        const auto roads = reader.ReadArray<RoadRecord>(header.road_count);
+        const auto buildings = reader.ReadArray<BuildingRecord>(header.building_count);
+        const auto offices = reader.ReadArray<OfficeRecord>(header.office_count);
+        const auto strings = reader.ReadBytes(header.strings_size);
+        if (!reader.AtEnd()) {
+            throw std::invalid_argument("Snapshot has trailing data");
+        }
+
+        Game game;
+        game.ReserveMaps(maps.size());
+        for (const auto& record : maps) {
+            const auto map_roads = Slice(roads, record.first_road, record.road_count);
+            const auto map_buildings = Slice(buildings, record.first_building, record.building_count);
+            const auto map_offices = Slice(offices, record.first_office, record.office_count);
+
+            Map map(Map::Id{ std::string{ GetString(strings, record.id) } }, std::string{ GetString(strings, record.name) });
+            map.Reserve(map_roads.size(), map_buildings.size(), map_offices.size());
+            for (const auto& road : map_roads) {
+                // Дорога горизонтальна, если концы на одной высоте. Вырожденная дорога-точка так и восстановится
+                if (road.y0 == road.y1) {
+                    map.AddRoad(Road{ Road::HORIZONTAL, Point{ road.x0, road.y0 }, road.x1 });
+                }
+                else {
+                    map.AddRoad(Road{ Road::VERTICAL, Point{ road.x0, road.y0 }, road.y1 });
+                }
+            }
+            for (const auto& building : map_buildings) {
+                map.AddBuilding(Building{ Rectangle{ Point{ building.x, building.y }, Size{ building.w, building.h } } });
+            }
+            for (const auto& office : map_offices) {
+                map.AddOffice(Office{ Office::Id{ std::string{ GetString(strings, office.id) } },
+                                      Point{ office.x, office.y }, Offset{ office.offset_x, office.offset_y } });
+            }
+            game.AddMap(std::move(map));
+        }
+        return game;
+    }
+
+}  // namespace game_snapshot
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <filesystem>
+
+#include "model.h"
+
+namespace game_snapshot {
+    /*
+     * Двоичный снимок загруженной модели игры для быстрого старта сервера.
+     * Файл - заголовок и плоские массивы записей фиксированного размера (карты, дороги, здания,
+     * офисы) плюс общий блок строк. Все числа - 32-битные в порядке байт машины, записавшей снимок.
+     * Заголовок хранит версию формата, метку порядка байт и CRC-32 всего, что идёт после него.
+     * Снимок отображается в память и переносится в модель без разбора отдельных значений.
+     * Это кэш, а не формат обмена: при смене версии формата его нужно пересобрать из JSON.
+     */
+
+    // Сохраняет game в path. Файл сначала пишется рядом под временным именем и затем переименовывается
+    void WriteSnapshot(const model::Game& game, const std::filesystem::path& path);
+
+    // Проверяет сигнатуру в начале файла, не читая его целиком
+    bool IsSnapshot(const std::filesystem::path& path);
+
+    // Загружает модель из снимка. При несовпадении версии, контрольной суммы или размеров бросает исключение
+    model::Game LoadSnapshot(const std::filesystem::path& path);
+
+}  // namespace game_snapshot
@@ -1,16 +1,23 @@
 #pragma once
 #include "sdk.h"
+#include "request_metrics.h"
+#include "session_arena.h"
 
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 
+#include <chrono>
 #include <iostream>
 #include <utility>
 #include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
 
 namespace http_server {
 
@@ -21,15 +28,80 @@ namespace http_server {
     using namespace std::literals;
     namespace sys = boost::system;
 
-    using HttpRequest = http::request<http::string_body>;
-    using HttpResponse = http::response<http::string_body>;
+    // Заголовки запросов и ответов размещаются в арене сессии
+    using HttpRequest = http::request<http::string_body, http::basic_fields<ArenaAllocator>>;
+    using HttpResponse = http::response<http::string_body, http::basic_fields<ArenaAllocator>>;
 
     void ReportError(beast::error_code ec, std::string_view what);
 
+#ifdef SO_REUSEPORT
+    // Позволяет нескольким акцепторам слушать один порт, ядро само распределяет между ними соединения
+    using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+    // Ответ, ожидающий отправки в составе пакета. Хранит сам ответ и writer'ы заголовка и тела,
+    // на буферы которых ссылается gather-запись, поэтому объект не перемещается до её окончания
+    class PendingResponse {
+    public:
+        virtual ~PendingResponse() = default;
+
+        // Дописывает в buffers байты ответа: строку статуса с заголовками и тело
+        virtual void AppendBuffers(std::vector<net::const_buffer>& buffers, beast::error_code& ec) = 0;
+        virtual bool NeedEof() const = 0;
+    };
+
+    template <typename Body, typename Fields>
+    class PendingResponseImpl final : public PendingResponse {
+    public:
+        explicit PendingResponseImpl(http::response<Body, Fields>&& response)
+            : response_(std::move(response)) {
+        }
+
+        // Тело отправляется как есть, поэтому ответ должен иметь Content-Length, а не chunked-кодирование
+        void AppendBuffers(std::vector<net::const_buffer>& buffers, beast::error_code& ec) override {
+            if (response_.chunked()) {
+                ec = make_error_code(sys::errc::operation_not_supported);
+                return;
+            }
+
+            header_writer_.emplace(response_.base(), response_.version(), response_.result_int());
+            const auto header = header_writer_->get();
+            buffers.insert(buffers.end(), net::buffer_sequence_begin(header), net::buffer_sequence_end(header));
+
+            body_writer_.emplace(response_.base(), response_.body());
+            body_writer_->init(ec);
+            while (!ec) {
+                auto result = body_writer_->get(ec);
+                if (ec || !result) {
+                    break;
+                }
+                const auto& [body, more] = *result;
+                buffers.insert(buffers.end(), net::buffer_sequence_begin(body), net::buffer_sequence_end(body));
+                if (!more) {
+                    break;
+                }
+            }
+        }
+
+        bool NeedEof() const override {
+            return response_.need_eof();
+        }
+
+    private:
+        http::response<Body, Fields> response_;
+        std::optional<typename Fields::writer> header_writer_;
+        std::optional<typename Body::writer> body_writer_;
+    };
+
     class SessionBase {
         // Напишите недостающий код, используя информацию из урока
     protected:
-        explicit SessionBase(tcp::socket&& socket) : stream_(std::move(socket)) {}
+        explicit SessionBase(tcp::socket&& socket) : stream_(std::move(socket)), request_(MakeRequest()) {
+            // Ответы и так собираются в одну запись, поэтому алгоритм Нейгла только задерживал бы
+            // отправку следующего пакета до прихода ACK от клиента
+            beast::error_code ec;
+            stream_.socket().set_option(tcp::no_delay(true), ec);
+        }
 
     public:
         SessionBase(const SessionBase&) = delete;
@@ -39,13 +111,20 @@ namespace http_server {
     public:
         void Run();
     private:
-        // Обработку запроса делегируем подклассу
+        // Обработку запроса делегируем подклассу. Ответ подкласс должен передать в Write, не выходя из HandleRequest.
+        // Если ответа не будет, сессия ответит за него сама (см. Dispatch)
         virtual void HandleRequest(HttpRequest&& request) = 0;
         virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
 
     private:
+        // Сколько запросов, уже лежащих в буфере, отвечаются одной записью в сокет
+        static constexpr std::size_t MAX_PIPELINED_REQUESTS = 32;
+
         void Read() {
-            request_ = {}; //Очищаем запрос от прежнего значения(Метод SessionBase::Read() мог вызываться несколько раз подряда)
+            //Очищаем запрос от прежнего значения(Метод SessionBase::Read() мог вызываться несколько раз подряда).
+            //Прошлые запросы и ответы на них к этому моменту уничтожены, поэтому арену можно переиспользовать
+            request_ = MakeRequest();
+            arena_.Reset();
             stream_.expires_after(30s);
             http::async_read(stream_, buffer_, request_,
                 //По окончании работы считывания буфера будет вызван привязанный хендлер
@@ -56,15 +135,75 @@ namespace http_server {
             Если клиент закрыл соединение, то сервер должен завершить сеанс.
             Если произошла ошибка чтения, выведите её в stdout.
             Если запрос прочитан без ошибок, делегируйте его обработку классу-наследнику.
+        Вслед за прочитанным запросом обрабатываются и те, что клиент успел прислать следом (pipelining),
+        а ответы на все них отправляются одной записью.
     */
-        void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+        void OnRead(beast::error_code ec, std::size_t bytes_read) {
+            metrics::RecordRead(bytes_read, !ec);
             if (ec == http::error::end_of_stream) { //Клиент закрыл соединение
                 Close();
             }
             if (ec) {
                 return ReportError(ec, "read"sv);
             }
-            HandleRequest(std::move(request_));
+            Dispatch(std::move(request_));
+            HandleBufferedRequests();
+            Flush();
+        }
+
+        void HandleBufferedRequests() {
+            while (pending_.size() < MAX_PIPELINED_REQUESTS && buffer_.size() != 0) {
+                if (!pending_.empty() && pending_.back()->NeedEof()) {
+                    break; // После этого ответа соединение будет закрыто
+                }
+                auto request = TryParseBufferedRequest();
+                if (!request) {
+                    break;
+                }
+                Dispatch(std::move(*request));
+            }
+        }
+
+        // Ответы уходят в порядке запросов, и клиент сопоставляет их по порядку. Поэтому на запрос,
+        // оставшийся без ответа, сессия отвечает 500 сама - иначе следующий ответ достался бы ему
+        void Dispatch(HttpRequest&& request) {
+            const unsigned version = request.version();
+            const bool keep_alive = request.keep_alive();
+            const std::size_t answered = pending_.size();
+            HandleRequest(std::move(request));
+            if (pending_.size() == answered) {
+                HttpResponse response(std::piecewise_construct, std::make_tuple(), std::make_tuple(arena_.GetAllocator()));
+                response.result(http::status::internal_server_error);
+                response.version(version);
+                response.keep_alive(keep_alive);
+                response.prepare_payload();
+                Write(std::move(response));
+            }
+        }
+
+        // Разбирает очередной запрос прямо из buffer_, не обращаясь к сокету. Если запрос пришёл
+        // не целиком или содержит ошибку, буфер не трогаем - с ним разберётся следующий async_read
+        std::optional<HttpRequest> TryParseBufferedRequest() {
+            http::request_parser<http::string_body, ArenaAllocator> parser(
+                std::piecewise_construct, std::make_tuple(), std::make_tuple(arena_.GetAllocator()));
+            parser.eager(true);
+
+            const auto data = buffer_.data();
+            std::size_t used = 0;
+            while (!parser.is_done()) {
+                beast::error_code ec;
+                const std::size_t parsed = parser.put(net::buffer(static_cast<const char*>(data.data()) + used, data.size() - used), ec);
+                used += parsed;
+                if (ec || parsed == 0) {
+                    return std::nullopt;
+                }
+            }
+            buffer_.consume(used);
+            return parser.release();
+        }
+
+        HttpRequest MakeRequest() {
+            return HttpRequest(std::piecewise_construct, std::make_tuple(), std::make_tuple(arena_.GetAllocator()));
         }
 
         void Close() {
@@ -75,17 +214,35 @@ namespace http_server {
     protected:
         template <typename Body, typename Fields>
         void Write(http::response<Body, Fields>&& response) {
-            // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
-            auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
-
-            auto self = GetSharedThis();
-            http::async_write(stream_, *safe_response,
-                [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-                    self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                });
+            // Ответ ждёт в пакете, пока не будут обработаны все полученные запросы, и лежит в арене сессии
+            pending_.push_back(std::allocate_shared<PendingResponseImpl<Body, Fields>>(arena_.GetAllocator(), std::move(response)));
         }
+
     private:
-        void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+        // Отправляет накопленные ответы одной gather-записью в порядке поступления запросов
+        void Flush() {
+            if (pending_.empty()) {
+                return;
+            }
+            write_buffers_.clear();
+            for (const auto& response : pending_) {
+                beast::error_code ec;
+                response->AppendBuffers(write_buffers_, ec);
+                if (ec) {
+                    pending_.clear();
+                    ReportError(ec, "write"sv);
+                    return Close();
+                }
+            }
+            write_started_ = std::chrono::steady_clock::now();
+            net::async_write(stream_, write_buffers_, beast::bind_front_handler(&SessionBase::OnWrite, GetSharedThis()));
+        }
+
+        void OnWrite(beast::error_code ec, std::size_t bytes_written) {
+            metrics::RecordWrite(bytes_written, pending_.size(), std::chrono::steady_clock::now() - write_started_, !ec);
+            const bool close = pending_.back()->NeedEof();
+            // Ответы могут лежать в арене сессии - уничтожаем их до её сброса в Read
+            pending_.clear();
             if (ec) return ReportError(ec, "write"sv);
             if (close) return Close(); // Семантика ответа требует закрыть соединение
             Read(); // Считываем следующий запрос
@@ -94,7 +251,11 @@ namespace http_server {
     private:
         beast::tcp_stream stream_; //Сокет поддерживающий таймауты
         beast::flat_buffer buffer_; //Динамический буффер для хранения информации
+        SessionArena arena_; //Память под заголовки текущих запросов и ответов, сбрасывается между циклами чтения
         HttpRequest request_; //Прочитанные запрос
+        std::vector<std::shared_ptr<PendingResponse>> pending_; //Ответы, ожидающие отправки
+        std::vector<net::const_buffer> write_buffers_; //Буферы gather-записи всех ответов из pending_
+        std::chrono::steady_clock::time_point write_started_; //Начало текущей записи, для метрик
     };
 
     template <typename RequestHandler>
@@ -127,10 +288,17 @@ namespace http_server {
     class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
         // Напишите недостающий код, используя информацию из урока
     public:
-        Listener(net::io_context& io, const tcp::endpoint& endpoint, RequestHandler&& request_handler) :
+        Listener(net::io_context& io, const tcp::endpoint& endpoint, RequestHandler&& request_handler, bool share_port = false) :
             io_{ io }, acceptor_{ net::make_strand(io) }, request_handler_(std::forward<RequestHandler>(request_handler)) {
             acceptor_.open(endpoint.protocol());
             acceptor_.set_option(net::socket_base::reuse_address(true));
+            if (share_port) {
+#ifdef SO_REUSEPORT
+                acceptor_.set_option(reuse_port(true));
+#else
+                throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+            }
             acceptor_.bind(endpoint);
             acceptor_.listen(net::socket_base::max_listen_connections);
         }
@@ -139,6 +307,10 @@ namespace http_server {
             DoAccept();
         }
 
+        tcp::endpoint GetLocalEndpoint() const {
+            return acceptor_.local_endpoint();
+        }
+
     private:
         void DoAccept() {
             acceptor_.async_accept(net::make_strand(io_),
@@ -163,15 +335,23 @@ namespace http_server {
         RequestHandler request_handler_; //Обработчик запросов
     };
 
+    /*
+     * Запускает приём соединений на endpoint.
+     * При share_port = true акцептор открывается с SO_REUSEPORT, и ServeHttp можно вызвать
+     * для одного и того же endpoint из нескольких io_context - по одному на ядро.
+     * Возвращает адрес, на котором принимаются соединения (с выбранным портом, если в endpoint порт 0).
+     */
     template <typename RequestHandler>
-    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+    tcp::endpoint ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler, bool share_port = false) {
         // Напишите недостающий код, используя информацию из урока
 
         // При помощи decay_t исключим ссылки из типа RequestHandler,
         // чтобы Listener хранил RequestHandler по значению
         using MyListener = Listener<std::decay_t<RequestHandler>>;
 
-        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+        auto listener = std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler), share_port);
+        listener->Run();
+        return listener->GetLocalEndpoint();
     }
 
 }  // namespace http_server
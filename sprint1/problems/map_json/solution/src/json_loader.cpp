@@ -1,12 +1,23 @@
 #include "json_loader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
+#include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace json_loader {
     using namespace model;
     namespace json = boost::json;
     using namespace std::literals;
 
+    LoadGame::LoadGame(unsigned num_threads) noexcept
+        : num_threads_{ std::max(1u, num_threads) } {
+    }
+
     Game LoadGame::operator()(const std::filesystem::path& json_path) {
         Game game;
 
@@ -17,34 +28,75 @@ namespace json_loader {
         std::string json((std::istreambuf_iterator<char>(incoming_stream)),
             std::istreambuf_iterator<char>());
 
-        auto json_object = json::parse(json).as_object();
-        const auto array_of_maps = json_object.at("maps").as_array();
-
-        for (const auto& map : array_of_maps) {
-            auto map_object = map.as_object();
-
-            auto id = CastBoostString(map.at("id").as_string());
-            auto name = CastBoostString(map.at("name").as_string());
+        const auto document = json::parse(json);
+        const auto& array_of_maps = document.as_object().at("maps").as_array();
 
-            Map recieved_map(Map::Id{ id }, name);
+        const size_t num_threads = std::min<size_t>(num_threads_, array_of_maps.size());
+        if (num_threads <= 1) {
+            for (const auto& map : array_of_maps) {
+                game.AddMap(LoadMap(map.as_object()));
+            }
+            return game;
+        }
 
-            LoadRoads(recieved_map, map_object.at("roads").as_array());
-            LoadBuildings(recieved_map, map_object.at("buildings").as_array());
-            LoadOffices(recieved_map, map_object.at("offices").as_array());
+        // Потоки разбирают карты по очереди через общий счётчик. Каждая карта пишется в свою ячейку,
+        // поэтому ни порядок, ни результат не зависят от того, какой поток её построил
+        std::vector<std::optional<Map>> maps(array_of_maps.size());
+        std::vector<std::exception_ptr> errors(array_of_maps.size());
+        std::atomic<size_t> next_map{ 0 };
+        const auto build_maps = [&] {
+            for (size_t i = next_map++; i < array_of_maps.size(); i = next_map++) {
+                try {
+                    maps[i].emplace(LoadMap(array_of_maps[i].as_object()));
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(num_threads - 1);
+            for (size_t i = 1; i < num_threads; ++i) {
+                workers.emplace_back(build_maps);
+            }
+            build_maps();
+        }
 
-            game.AddMap(std::move(recieved_map));
+        // Ошибки и дубликаты id обнаруживаются в порядке файла - так же, как при последовательной загрузке
+        for (size_t i = 0; i < maps.size(); ++i) {
+            if (errors[i]) {
+                std::rethrow_exception(errors[i]);
+            }
+            game.AddMap(std::move(*maps[i]));
         }
 
         return game;
     }
 
-    std::string LoadGame::CastBoostString(const json::string& boost_string) {
+    Map LoadGame::LoadMap(const json::object& map_object) const {
+        auto id = CastBoostString(map_object.at("id").as_string());
+        auto name = CastBoostString(map_object.at("name").as_string());
+
+        Map recieved_map(Map::Id{ id }, name);
+
+        LoadRoads(recieved_map, map_object.at("roads").as_array());
+        LoadBuildings(recieved_map, map_object.at("buildings").as_array());
+        LoadOffices(recieved_map, map_object.at("offices").as_array());
+
+        // Индексы строятся здесь, чтобы при параллельной загрузке это тоже шло на потоках пула
+        recieved_map.BuildIndex();
+
+        return recieved_map;
+    }
+
+    std::string LoadGame::CastBoostString(const json::string& boost_string) const {
         return { boost_string.begin(), boost_string.end() };
     }
 
-    void LoadGame::LoadRoads(Map& map, boost::json::array& array_of_roads) {
+    void LoadGame::LoadRoads(Map& map, const boost::json::array& array_of_roads) const {
         for (const auto& road : array_of_roads) {
-            auto road_object = road.as_object();
+            const auto& road_object = road.as_object();
 
             int x0 = static_cast<int>(road_object.at("x0").as_int64());
             int y0 = static_cast<int>(road_object.at("y0").as_int64());
@@ -60,9 +112,9 @@ namespace json_loader {
         }
     }
 
-    void LoadGame::LoadBuildings(Map& map, boost::json::array& array_of_buildings) {
+    void LoadGame::LoadBuildings(Map& map, const boost::json::array& array_of_buildings) const {
         for (const auto& building : array_of_buildings) {
-            auto building_object = building.as_object();
+            const auto& building_object = building.as_object();
 
             int x = static_cast<int>(building_object.at("x").as_int64());
             int y = static_cast<int>(building_object.at("y").as_int64());
@@ -73,9 +125,9 @@ namespace json_loader {
         }
     }
 
-    void LoadGame::LoadOffices(Map& map, boost::json::array& array_of_offices) {
+    void LoadGame::LoadOffices(Map& map, const boost::json::array& array_of_offices) const {
         for (const auto& office : array_of_offices) {
-            auto office_object = office.as_object();
+            const auto& office_object = office.as_object();
 
             std::string id = CastBoostString(office_object.at("id").as_string());
             int x = static_cast<int>(office_object.at("x").as_int64());
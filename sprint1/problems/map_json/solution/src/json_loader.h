@@ -5,13 +5,23 @@
 #include "model.h"
 
 namespace json_loader {
+	/*
+	 * Загрузчик конфигурации через DOM Boost.JSON.
+	 * При num_threads > 1 карты после разбора документа строятся параллельно на num_threads потоках
+	 * и добавляются в Game в порядке следования в файле, так что результат совпадает с однопоточным.
+	 */
 	class LoadGame {
 	public:
+		explicit LoadGame(unsigned num_threads = 1) noexcept;
+
 		model::Game operator()(const std::filesystem::path& json_path);
 	private:
-		std::string CastBoostString(const boost::json::string& boost_string);
-		void LoadRoads(model::Map& map, boost::json::array& array_of_roads);
-        void LoadBuildings(model::Map& map, boost::json::array& array_of_buildings);
-        void LoadOffices(model::Map& map, boost::json::array& array_of_offices);
+		model::Map LoadMap(const boost::json::object& map_object) const;
+		std::string CastBoostString(const boost::json::string& boost_string) const;
+		void LoadRoads(model::Map& map, const boost::json::array& array_of_roads) const;
+        void LoadBuildings(model::Map& map, const boost::json::array& array_of_buildings) const;
+        void LoadOffices(model::Map& map, const boost::json::array& array_of_offices) const;
+
+		unsigned num_threads_;
 	};
 }  // namespace json_loader
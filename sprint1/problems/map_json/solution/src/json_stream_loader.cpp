@@ -0,0 +1,506 @@
+#include "json_stream_loader.h"
+
+#include <boost/json/basic_parser.hpp>
+#include <boost/json/error.hpp>
+#include <boost/system/system_error.hpp>
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace json_loader {
+    using namespace model;
+    namespace json = boost::json;
+    namespace sys = boost::system;
+    using namespace std::literals;
+
+    namespace {
+        // Где в документе находится парсер
+        enum class Scope : std::uint8_t {
+            DOCUMENT,   // вне корневого объекта
+            ROOT,       // корневой объект
+            MAPS,       // массив maps
+            MAP,        // объект карты
+            ROADS,
+            ROAD,
+            BUILDINGS,
+            BUILDING,
+            OFFICES,
+            OFFICE,
+        };
+
+        // Известные ключи. Значения остальных ключей пропускаются целиком
+        enum class Field : std::uint8_t {
+            NONE,
+            MAPS,
+            ID,
+            NAME,
+            ROADS,
+            BUILDINGS,
+            OFFICES,
+            X0,
+            Y0,
+            X1,
+            Y1,
+            X,
+            Y,
+            W,
+            H,
+            OFFSET_X,
+            OFFSET_Y,
+            COUNT,
+        };
+
+        constexpr std::size_t FIELD_COUNT = static_cast<std::size_t>(Field::COUNT);
+
+        Field FindField(Scope scope, std::string_view key) noexcept {
+            switch (scope) {
+            case Scope::ROOT:
+                return key == "maps"sv ? Field::MAPS : Field::NONE;
+            case Scope::MAP:
+                if (key == "id"sv) return Field::ID;
+                if (key == "name"sv) return Field::NAME;
+                if (key == "roads"sv) return Field::ROADS;
+                if (key == "buildings"sv) return Field::BUILDINGS;
+                if (key == "offices"sv) return Field::OFFICES;
+                return Field::NONE;
+            case Scope::ROAD:
+                if (key == "x0"sv) return Field::X0;
+                if (key == "y0"sv) return Field::Y0;
+                if (key == "x1"sv) return Field::X1;
+                if (key == "y1"sv) return Field::Y1;
+                return Field::NONE;
+            case Scope::BUILDING:
+                if (key == "x"sv) return Field::X;
+                if (key == "y"sv) return Field::Y;
+                if (key == "w"sv) return Field::W;
+                if (key == "h"sv) return Field::H;
+                return Field::NONE;
+            case Scope::OFFICE:
+                if (key == "id"sv) return Field::ID;
+                if (key == "x"sv) return Field::X;
+                if (key == "y"sv) return Field::Y;
+                if (key == "offsetX"sv) return Field::OFFSET_X;
+                if (key == "offsetY"sv) return Field::OFFSET_Y;
+                return Field::NONE;
+            default:
+                return Field::NONE;
+            }
+        }
+
+        // Поля объекта, который разбирается сейчас: числа, строки и отметки о встреченных ключах
+        struct ObjectFields {
+            std::array<int, FIELD_COUNT> numbers{};
+            std::string id;
+            std::string name;
+            std::bitset<FIELD_COUNT> seen;
+
+            bool Has(Field field) const noexcept {
+                return seen.test(static_cast<std::size_t>(field));
+            }
+
+            int Get(Field field) const noexcept {
+                return numbers[static_cast<std::size_t>(field)];
+            }
+
+            void Reset() noexcept {
+                id.clear();
+                name.clear();
+                seen.reset();
+            }
+        };
+
+        /*
+         * Обработчик событий basic_parser. Ведёт текущую область (Scope) и ключ (Field),
+         * поля элемента копит в ObjectFields, а элементы карты - в векторах, которые
+         * переиспользуются от карты к карте. Любое отклонение от формата останавливает разбор
+         * с текстом ошибки в GetError().
+         */
+        class GameHandler {
+        public:
+            static constexpr std::size_t max_object_size = std::numeric_limits<std::size_t>::max();
+            static constexpr std::size_t max_array_size = std::numeric_limits<std::size_t>::max();
+            static constexpr std::size_t max_key_size = std::numeric_limits<std::size_t>::max();
+            static constexpr std::size_t max_string_size = std::numeric_limits<std::size_t>::max();
+
+            bool on_document_begin(sys::error_code&) {
+                return true;
+            }
+
+            bool on_document_end(sys::error_code&) {
+                return true;
+            }
+
+            bool on_object_begin(sys::error_code& ec) {
+                if (skip_depth_ > 0) {
+                    ++skip_depth_;
+                    return true;
+                }
+                switch (scope_) {
+                case Scope::DOCUMENT:
+                    return Enter(Scope::ROOT);
+                case Scope::MAPS:
+                    map_fields_.Reset();
+                    roads_.clear();
+                    buildings_.clear();
+                    offices_.clear();
+                    return Enter(Scope::MAP);
+                case Scope::ROADS:
+                    element_fields_.Reset();
+                    return Enter(Scope::ROAD);
+                case Scope::BUILDINGS:
+                    element_fields_.Reset();
+                    return Enter(Scope::BUILDING);
+                case Scope::OFFICES:
+                    element_fields_.Reset();
+                    return Enter(Scope::OFFICE);
+                default:
+                    return SkipOrFail(ec, "Unexpected object"sv);
+                }
+            }
+
+            bool on_object_end(std::size_t, sys::error_code& ec) {
+                if (skip_depth_ > 0) {
+                    --skip_depth_;
+                    return true;
+                }
+                switch (scope_) {
+                case Scope::ROOT:
+                    if (!seen_maps_) {
+                        return Fail(ec, "Config has no maps"sv);
+                    }
+                    return Enter(Scope::DOCUMENT);
+                case Scope::MAP:
+                    return FinishMap(ec) && Enter(Scope::MAPS);
+                case Scope::ROAD:
+                    return FinishRoad(ec) && Enter(Scope::ROADS);
+                case Scope::BUILDING:
+                    return FinishBuilding(ec) && Enter(Scope::BUILDINGS);
+                case Scope::OFFICE:
+                    return FinishOffice(ec) && Enter(Scope::OFFICES);
+                default:
+                    return Fail(ec, "Unexpected end of object"sv);
+                }
+            }
+
+            bool on_array_begin(sys::error_code& ec) {
+                if (skip_depth_ > 0) {
+                    ++skip_depth_;
+                    return true;
+                }
+                if (scope_ == Scope::ROOT && field_ == Field::MAPS) {
+                    seen_maps_ = true;
+                    return Enter(Scope::MAPS);
+                }
+                if (scope_ == Scope::MAP) {
+                    switch (field_) {
+                    case Field::ROADS:
+                        return Enter(Scope::ROADS);
+                    case Field::BUILDINGS:
+                        return Enter(Scope::BUILDINGS);
+                    case Field::OFFICES:
+                        return Enter(Scope::OFFICES);
+                    default:
+                        break;
+                    }
+                }
+                return SkipOrFail(ec, "Unexpected array"sv);
+            }
+
+            bool on_array_end(std::size_t, sys::error_code& ec) {
+                if (skip_depth_ > 0) {
+                    --skip_depth_;
+                    return true;
+                }
+                switch (scope_) {
+                case Scope::MAPS:
+                    return Enter(Scope::ROOT);
+                case Scope::ROADS:
+                case Scope::BUILDINGS:
+                case Scope::OFFICES:
+                    return Enter(Scope::MAP);
+                default:
+                    return Fail(ec, "Unexpected end of array"sv);
+                }
+            }
+
+            bool on_key_part(std::string_view part, std::size_t, sys::error_code&) {
+                key_.append(part);
+                return true;
+            }
+
+            bool on_key(std::string_view part, std::size_t, sys::error_code&) {
+                if (skip_depth_ > 0) {
+                    key_.clear();
+                    return true;
+                }
+                if (key_.empty()) {
+                    field_ = FindField(scope_, part);
+                }
+                else {
+                    key_.append(part);
+                    field_ = FindField(scope_, key_);
+                    key_.clear();
+                }
+                if (field_ != Field::NONE && scope_ != Scope::ROOT) {
+                    CurrentFields().seen.set(static_cast<std::size_t>(field_));
+                    if (auto* target = StringTarget()) {
+                        target->clear();
+                    }
+                }
+                return true;
+            }
+
+            bool on_string_part(std::string_view part, std::size_t, sys::error_code& ec) {
+                return AppendString(part, ec);
+            }
+
+            bool on_string(std::string_view part, std::size_t, sys::error_code& ec) {
+                return AppendString(part, ec);
+            }
+
+            bool on_number_part(std::string_view, sys::error_code&) {
+                return true;
+            }
+
+            bool on_int64(std::int64_t value, std::string_view, sys::error_code& ec) {
+                if (skip_depth_ > 0 || IsIgnoredValue()) {
+                    return true;
+                }
+                if (!IsElementScope() || StringTarget() != nullptr) {
+                    return Fail(ec, "Unexpected number"sv);
+                }
+                element_fields_.numbers[static_cast<std::size_t>(field_)] = static_cast<int>(value);
+                return true;
+            }
+
+            bool on_uint64(std::uint64_t, std::string_view, sys::error_code& ec) {
+                return ScalarOrFail(ec, "Integer is out of range"sv);
+            }
+
+            bool on_double(double, std::string_view, sys::error_code& ec) {
+                return ScalarOrFail(ec, "Expected an integer"sv);
+            }
+
+            bool on_bool(bool, sys::error_code& ec) {
+                return ScalarOrFail(ec, "Unexpected boolean"sv);
+            }
+
+            bool on_null(sys::error_code& ec) {
+                return ScalarOrFail(ec, "Unexpected null"sv);
+            }
+
+            bool on_comment_part(std::string_view, sys::error_code&) {
+                return true;
+            }
+
+            bool on_comment(std::string_view, sys::error_code&) {
+                return true;
+            }
+
+            const std::string& GetError() const noexcept {
+                return error_;
+            }
+
+            Game ReleaseGame() noexcept {
+                return std::move(game_);
+            }
+
+        private:
+            bool Enter(Scope scope) noexcept {
+                scope_ = scope;
+                field_ = Field::NONE;
+                return true;
+            }
+
+            bool Fail(sys::error_code& ec, std::string_view message) {
+                error_ = message;
+                ec = sys::errc::make_error_code(sys::errc::invalid_argument);
+                return false;
+            }
+
+            bool IsObjectScope() const noexcept {
+                return scope_ == Scope::ROOT || scope_ == Scope::MAP || IsElementScope();
+            }
+
+            bool IsElementScope() const noexcept {
+                return scope_ == Scope::ROAD || scope_ == Scope::BUILDING || scope_ == Scope::OFFICE;
+            }
+
+            // Значение неизвестного ключа, которое не нужно разбирать
+            bool IsIgnoredValue() const noexcept {
+                return IsObjectScope() && field_ == Field::NONE;
+            }
+
+            // Объект или массив под неизвестным ключом пропускается вместе со всем содержимым
+            bool SkipOrFail(sys::error_code& ec, std::string_view message) {
+                if (IsIgnoredValue()) {
+                    skip_depth_ = 1;
+                    return true;
+                }
+                return Fail(ec, message);
+            }
+
+            bool ScalarOrFail(sys::error_code& ec, std::string_view message) {
+                if (skip_depth_ > 0 || IsIgnoredValue()) {
+                    return true;
+                }
+                return Fail(ec, message);
+            }
+
+            ObjectFields& CurrentFields() noexcept {
+                return scope_ == Scope::MAP ? map_fields_ : element_fields_;
+            }
+
+            // Строка, в которую записывается значение текущего ключа, или nullptr для нестроковых ключей
+            std::string* StringTarget() noexcept {
+                if (scope_ == Scope::MAP) {
+                    if (field_ == Field::ID) return &map_fields_.id;
+                    if (field_ == Field::NAME) return &map_fields_.name;
+                }
+                else if (scope_ == Scope::OFFICE && field_ == Field::ID) {
+                    return &element_fields_.id;
+                }
+                return nullptr;
+            }
+
+            bool AppendString(std::string_view part, sys::error_code& ec) {
+                if (skip_depth_ > 0 || IsIgnoredValue()) {
+                    return true;
+                }
+                auto* target = StringTarget();
+                if (target == nullptr) {
+                    return Fail(ec, "Unexpected string"sv);
+                }
+                target->append(part);
+                return true;
+            }
+
+            bool Require(const ObjectFields& fields, std::initializer_list<Field> required, sys::error_code& ec,
+                         std::string_view message) {
+                for (const auto field : required) {
+                    if (!fields.Has(field)) {
+                        return Fail(ec, message);
+                    }
+                }
+                return true;
+            }
+
+            bool FinishRoad(sys::error_code& ec) {
+                const auto& fields = element_fields_;
+                if (!Require(fields, { Field::X0, Field::Y0 }, ec, "Road must have x0 and y0"sv)) {
+                    return false;
+                }
+                const Point start{ fields.Get(Field::X0), fields.Get(Field::Y0) };
+                // Как и LoadGame, дорогу без x1 и y1 пропускаем
+                if (fields.Has(Field::X1)) {
+                    roads_.emplace_back(Road::HORIZONTAL, start, fields.Get(Field::X1));
+                }
+                else if (fields.Has(Field::Y1)) {
+                    roads_.emplace_back(Road::VERTICAL, start, fields.Get(Field::Y1));
+                }
+                return true;
+            }
+
+            bool FinishBuilding(sys::error_code& ec) {
+                const auto& fields = element_fields_;
+                if (!Require(fields, { Field::X, Field::Y, Field::W, Field::H }, ec, "Building must have x, y, w and h"sv)) {
+                    return false;
+                }
+                buildings_.emplace_back(Rectangle{ Point{ fields.Get(Field::X), fields.Get(Field::Y) },
+                                                   Size{ fields.Get(Field::W), fields.Get(Field::H) } });
+                return true;
+            }
+
+            bool FinishOffice(sys::error_code& ec) {
+                const auto& fields = element_fields_;
+                if (!Require(fields, { Field::ID, Field::X, Field::Y, Field::OFFSET_X, Field::OFFSET_Y }, ec,
+                             "Office must have id, x, y, offsetX and offsetY"sv)) {
+                    return false;
+                }
+                offices_.emplace_back(Office::Id{ fields.id }, Point{ fields.Get(Field::X), fields.Get(Field::Y) },
+                                      Offset{ fields.Get(Field::OFFSET_X), fields.Get(Field::OFFSET_Y) });
+                return true;
+            }
+
+            bool FinishMap(sys::error_code& ec) {
+                if (!Require(map_fields_, { Field::ID, Field::NAME, Field::ROADS, Field::BUILDINGS, Field::OFFICES }, ec,
+                             "Map must have id, name, roads, buildings and offices"sv)) {
+                    return false;
+                }
+                Map map(Map::Id{ map_fields_.id }, map_fields_.name);
+                for (const auto& road : roads_) {
+                    map.AddRoad(road);
+                }
+                for (const auto& building : buildings_) {
+                    map.AddBuilding(building);
+                }
+                for (auto& office : offices_) {
+                    map.AddOffice(std::move(office));
+                }
+                game_.AddMap(std::move(map));
+                return true;
+            }
+
+            Game game_;
+            Scope scope_ = Scope::DOCUMENT;
+            Field field_ = Field::NONE;
+            std::size_t skip_depth_ = 0;
+            bool seen_maps_ = false;
+            std::string key_;
+            std::string error_;
+
+            ObjectFields map_fields_;
+            ObjectFields element_fields_;
+            std::vector<Road> roads_;
+            std::vector<Building> buildings_;
+            std::vector<Office> offices_;
+        };
+    }  // namespace
+
+    Game StreamLoadGame::operator()(const std::filesystem::path& json_path) {
+        std::ifstream incoming_stream(json_path, std::ios::binary);
+        if (!incoming_stream.is_open()) {
+            throw std::invalid_argument("Could not open file!");
+        }
+
+        json::basic_parser<GameHandler> parser{ json::parse_options{} };
+        std::vector<char> chunk(CHUNK_SIZE);
+        sys::error_code ec;
+
+        while (!ec && incoming_stream) {
+            incoming_stream.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            const auto size = static_cast<std::size_t>(incoming_stream.gcount());
+            if (size == 0) {
+                break;
+            }
+            // Парсер останавливается после корневого значения. Если за ним в файле есть что-то ещё,
+            // блок принят не целиком - это ошибка, как и у json::parse в LoadGame
+            if (parser.write_some(true, chunk.data(), size, ec) < size && !ec) {
+                ec = json::error::extra_data;
+            }
+        }
+        if (incoming_stream.bad()) {
+            throw std::runtime_error("Could not read file!");
+        }
+        if (!ec) {
+            parser.write_some(false, nullptr, 0, ec);
+        }
+        if (ec) {
+            if (const auto& error = parser.handler().GetError(); !error.empty()) {
+                throw std::invalid_argument(error);
+            }
+            throw sys::system_error(ec);
+        }
+
+        return parser.handler().ReleaseGame();
+    }
+
+}  // namespace json_loader
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+#include "model.h"
+
+namespace json_loader {
+    /*
+     * Потоковый загрузчик конфигурации. Файл читается блоками по CHUNK_SIZE байт и разбирается
+     * SAX-парсером boost::json::basic_parser, карты строятся прямо из событий парсера без
+     * промежуточного DOM. Память на разбор ограничена буфером чтения и данными одной карты,
+     * независимо от размера файла. Требования к формату те же, что у LoadGame.
+     */
+    class StreamLoadGame {
+    public:
+        static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+        model::Game operator()(const std::filesystem::path& json_path);
+    };
+}  // namespace json_loader
@@ -0,0 +1,162 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace metrics {
+
+    /*
+     * Счётчик с единственным писателем и любым числом читателей.
+     * Инкремент - обычные load + store без lock-префикса, но читатель из другого потока
+     * (например, при выгрузке метрик) видит корректное, пусть и чуть устаревшее, значение.
+     */
+    class RelaxedCounter {
+    public:
+        RelaxedCounter() = default;
+
+        RelaxedCounter(const RelaxedCounter&) = delete;
+        RelaxedCounter& operator=(const RelaxedCounter&) = delete;
+
+        RelaxedCounter& operator=(std::uint64_t value) noexcept {
+            value_.store(value, std::memory_order_relaxed);
+            return *this;
+        }
+
+        RelaxedCounter& operator+=(std::uint64_t delta) noexcept {
+            value_.store(value_.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+            return *this;
+        }
+
+        RelaxedCounter& operator++() noexcept {
+            return *this += 1;
+        }
+
+        operator std::uint64_t() const noexcept {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::uint64_t> value_{ 0 };
+    };
+
+    /*
+     * Лог-линейная гистограмма задержек в духе HdrHistogram.
+     * Значения до 2 * SUB_BUCKETS хранятся точно, дальше каждый диапазон [2^k, 2^(k+1))
+     * делится на SUB_BUCKETS равных корзин - относительная погрешность не больше 1 / SUB_BUCKETS.
+     * Запись - это вычисление индекса и инкремент счётчика, без аллокаций и ветвлений по диапазонам.
+     * Counter - std::uint64_t для однопоточного использования или RelaxedCounter, если
+     * гистограмму читают из других потоков.
+     */
+    template <typename Counter>
+    class BasicLatencyHistogram {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS = 5;
+        static constexpr std::uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+        static constexpr std::size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        static constexpr std::size_t BucketIndex(std::uint64_t value) noexcept {
+            if (value < SUB_BUCKETS) {
+                return static_cast<std::size_t>(value);
+            }
+            const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - 1 - SUB_BUCKET_BITS;
+            return static_cast<std::size_t>((shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS));
+        }
+
+        // Наибольшее значение, попадающее в корзину index
+        static constexpr std::uint64_t BucketUpperBound(std::size_t index) noexcept {
+            if (index < 2 * SUB_BUCKETS) {
+                return index;
+            }
+            const unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS) - 1;
+            const std::uint64_t sub_bucket = index % SUB_BUCKETS + SUB_BUCKETS;
+            return ((sub_bucket + 1) << shift) - 1;
+        }
+
+        void Record(std::uint64_t value) noexcept {
+            ++counts_[BucketIndex(value)];
+            ++total_count_;
+            sum_ += value;
+            if (value > max_) {
+                max_ = value;
+            }
+        }
+
+        template <typename OtherCounter>
+        void Merge(const BasicLatencyHistogram<OtherCounter>& other) noexcept {
+            for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+                counts_[i] += other.GetBucketCount(i);
+            }
+            total_count_ += other.GetTotalCount();
+            sum_ += other.GetSum();
+            if (other.GetMax() > max_) {
+                max_ = other.GetMax();
+            }
+        }
+
+        void Reset() noexcept {
+            for (auto& count : counts_) {
+                count = 0;
+            }
+            total_count_ = 0;
+            sum_ = 0;
+            max_ = 0;
+        }
+
+        std::uint64_t GetTotalCount() const noexcept {
+            return total_count_;
+        }
+
+        std::uint64_t GetSum() const noexcept {
+            return sum_;
+        }
+
+        std::uint64_t GetMax() const noexcept {
+            return max_;
+        }
+
+        std::uint64_t GetBucketCount(std::size_t index) const noexcept {
+            return counts_[index];
+        }
+
+        // Число записей со значением не больше value (с точностью до границы корзины)
+        std::uint64_t CountAtOrBelow(std::uint64_t value) const noexcept {
+            std::uint64_t count = 0;
+            for (std::size_t i = 0; i < BUCKET_COUNT && BucketUpperBound(i) <= value; ++i) {
+                count += counts_[i];
+            }
+            return count;
+        }
+
+        // Значение, не меньше которого percentile процентов записей (percentile в диапазоне [0, 100])
+        std::uint64_t ValueAtPercentile(double percentile) const noexcept {
+            const std::uint64_t total = total_count_;
+            const std::uint64_t max = max_;
+            if (total == 0) {
+                return 0;
+            }
+            const double fraction = std::clamp(percentile, 0.0, 100.0) / 100.0;
+            const auto target = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(fraction * static_cast<double>(total) + 0.5));
+
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+                seen += counts_[i];
+                if (seen >= target) {
+                    return std::min(BucketUpperBound(i), max);
+                }
+            }
+            return max;
+        }
+
+    private:
+        std::array<Counter, BUCKET_COUNT> counts_{};
+        Counter total_count_{};
+        Counter sum_{};
+        Counter max_{};
+    };
+
+    using LatencyHistogram = BasicLatencyHistogram<std::uint64_t>;
+
+}  // namespace metrics
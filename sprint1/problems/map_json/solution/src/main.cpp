@@ -2,11 +2,24 @@
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <pthread.h>
+#include <sched.h>
+
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <utility>
+#include <vector>
 
+#include "game_snapshot.h"
 #include "json_loader.h"
+#include "json_stream_loader.h"
 #include "request_handler.h"
 
 using namespace std::literals;
@@ -25,27 +38,160 @@ namespace {
         fn();
     }
 
+    // Номера процессоров, на которых процессу разрешено работать, по возрастанию. Под cpuset
+    // контейнера или taskset это не обязательно 0..n-1. Пусто, если набор прочитать не удалось
+    std::vector<int> GetAllowedCpus() {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        std::vector<int> cpus;
+        if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+            std::cerr << "Could not read the CPU affinity: "sv << std::strerror(errno) << std::endl;
+            return cpus;
+        }
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpu_set)) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    // Привязывает текущий поток к процессору cpu. Неудача не критична - поток просто останется
+    // непривязанным. О ней сообщается один раз, а не для каждого потока
+    void PinCurrentThreadToCpu(int cpu) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        if (const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set); error != 0) {
+            static std::once_flag reported;
+            std::call_once(reported, [cpu, error] {
+                std::cerr << "Could not pin a worker thread to CPU "sv << cpu << ": "sv << std::strerror(error) << std::endl;
+                });
+        }
+    }
+
+    // Запускает по одному io_context на поток. i-й поток привязывается к i-му процессору из cpus,
+    // потоки без своего процессора остаются непривязанными
+    void RunPinnedWorkers(std::vector<std::unique_ptr<net::io_context>>& contexts, const std::vector<int>& cpus) {
+        const auto run = [&contexts, &cpus](std::size_t i) {
+            if (i < cpus.size()) {
+                PinCurrentThreadToCpu(cpus[i]);
+            }
+            contexts[i]->run();
+        };
+        std::vector<std::jthread> workers;
+        workers.reserve(contexts.size() - 1);
+        for (std::size_t i = 1; i < contexts.size(); ++i) {
+            workers.emplace_back(run, i);
+        }
+        run(0);
+    }
+
+    constexpr std::string_view REUSE_PORT_FLAG = "--reuse-port"sv;
+    constexpr std::string_view PARALLEL_LOAD_FLAG = "--parallel-load"sv;
+    constexpr std::string_view COMPILE_CONFIG_FLAG = "--compile-config"sv;
+
+    struct Args {
+        std::string config_file;
+        std::string snapshot_file; // непусто в режиме --compile-config
+        bool reuse_port = false;
+        bool parallel_load = false;
+    };
+
+    // Первый аргумент - файл конфигурации, за ним в любом порядке необязательные флаги.
+    // Либо --compile-config <config> <snapshot>
+    std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+        if (argc < 2) {
+            return std::nullopt;
+        }
+        Args args;
+        if (argv[1] == COMPILE_CONFIG_FLAG) {
+            if (argc != 4) {
+                return std::nullopt;
+            }
+            args.config_file = argv[2];
+            args.snapshot_file = argv[3];
+            return args;
+        }
+        args.config_file = argv[1];
+        for (int i = 2; i < argc; ++i) {
+            if (argv[i] == REUSE_PORT_FLAG) {
+                args.reuse_port = true;
+            }
+            else if (argv[i] == PARALLEL_LOAD_FLAG) {
+                args.parallel_load = true;
+            }
+            else {
+                return std::nullopt;
+            }
+        }
+        return args;
+    }
+
 }  //namespace
 
 int main(int argc, const char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: game_server <game-config-json>"sv << std::endl;
+    /*
+     * В режиме --reuse-port сервер создаёт по io_context на каждый доступный процессу процессор
+     * (с учётом cpuset и taskset) и привязывает к нему поток, каждый io_context со своим
+     * акцептором на общем порту (SO_REUSEPORT). Ядро ОС распределяет соединения между ними,
+     * и потоки не конкурируют за общую очередь io_context. Модель игры при этом общая.
+     *
+     * По умолчанию конфигурация читается потоковым загрузчиком с ограниченным расходом памяти.
+     * С --parallel-load она разбирается в DOM, и карты строятся на всех ядрах - так быстрее
+     * на многоядерной машине, но весь документ на время загрузки находится в памяти.
+     *
+     * --compile-config сохраняет загруженную конфигурацию в двоичный снимок и завершается.
+     * Снимок можно передать серверу вместо JSON - он узнаётся по сигнатуре и загружается
+     * отображением в память, без разбора JSON.
+     */
+    const auto args = ParseCommandLine(argc, argv);
+    if (!args) {
+        std::cerr << "Usage: game_server <game-config-json-or-snapshot> ["sv << REUSE_PORT_FLAG << "] ["sv
+            << PARALLEL_LOAD_FLAG << "]"sv << std::endl;
+        std::cerr << "       game_server "sv << COMPILE_CONFIG_FLAG << " <game-config-json> <snapshot>"sv << std::endl;
         return EXIT_FAILURE;
     }
+    const bool reuse_port = args->reuse_port;
     try {
+        const unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+
         // 1. Загружаем карту из файла и построить модель игры
-        model::Game game = json_loader::LoadGame()(argv[1]);
+        model::Game game = game_snapshot::IsSnapshot(args->config_file)
+            ? game_snapshot::LoadSnapshot(args->config_file)
+            : args->parallel_load
+            ? json_loader::LoadGame(num_threads)(args->config_file)
+            : json_loader::StreamLoadGame()(args->config_file);
+
+        if (!args->snapshot_file.empty()) {
+            game_snapshot::WriteSnapshot(game, args->snapshot_file);
+            std::cout << "Snapshot of "sv << game.GetMaps().size() << " maps written to "sv << args->snapshot_file << std::endl;
+            return EXIT_SUCCESS;
+        }
 
-        // 2. Инициализируем io_context
-        const unsigned num_threads = std::thread::hardware_concurrency();
-        net::io_context ioc(num_threads);
+        // 2. Инициализируем io_context - один общий или по одному на каждый разрешённый процессу процессор
+        std::vector<std::unique_ptr<net::io_context>> contexts;
+        const std::vector<int> cpus = reuse_port ? GetAllowedCpus() : std::vector<int>{};
+        if (reuse_port) {
+            const std::size_t num_contexts = cpus.empty() ? num_threads : cpus.size();
+            contexts.reserve(num_contexts);
+            for (std::size_t i = 0; i < num_contexts; ++i) {
+                contexts.push_back(std::make_unique<net::io_context>(1));
+            }
+        }
+        else {
+            contexts.push_back(std::make_unique<net::io_context>(num_threads));
+        }
+        net::io_context& ioc = *contexts.front();
 
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const boost::system::error_code ec, [[maybe_unused]] int signal_number) {
+        signals.async_wait([&contexts](const boost::system::error_code ec, [[maybe_unused]] int signal_number) {
             if (!ec) {
                 std::cout << "Signal "sv << signal_number << " received"sv << std::endl;
-                ioc.stop();
+                for (auto& context : contexts) {
+                    context->stop();
+                }
             }
             });
 
@@ -55,17 +201,24 @@ int main(int argc, const char* argv[]) {
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         constexpr unsigned port = 8080;
         const auto address = net::ip::make_address("0.0.0.0");
-        http_server::ServeHttp(ioc, { address, port }, [&handler](auto&& req, auto&& send) {
-            handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
-            });
+        for (auto& context : contexts) {
+            http_server::ServeHttp(*context, { address, port }, [&handler](auto&& req, auto&& send) {
+                handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
+                }, reuse_port);
+        }
 
         // Эта надпись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы
         std::cout << "Server has started..."sv << std::endl;
 
         // 6. Запускаем обработку асинхронных операций
-        RunWorkers(std::max(1u, num_threads), [&ioc] {
-            ioc.run();
-            });
+        if (reuse_port) {
+            RunPinnedWorkers(contexts, cpus);
+        }
+        else {
+            RunWorkers(num_threads, [&ioc] {
+                ioc.run();
+                });
+        }
     }
     catch (const std::exception& ex) {
         std::cerr << ex.what() << std::endl;
@@ -1,10 +1,354 @@
 #include "model.h"
 
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
+#include <tuple>
 
 namespace model {
     using namespace std::literals;
 
+    RoadIndex::AxisRoads::AxisRoads(std::vector<Segment> segments) {
+        std::sort(segments.begin(), segments.end(), [](const Segment& lhs, const Segment& rhs) {
+            return std::tie(lhs.line, lhs.begin, lhs.road) < std::tie(rhs.line, rhs.begin, rhs.road);
+            });
+
+        begins_.reserve(segments.size());
+        reaches_.reserve(segments.size());
+        reach_roads_.reserve(segments.size());
+        roads_.reserve(segments.size());
+        for (const auto& segment : segments) {
+            const bool new_line = lines_.empty() || lines_.back() != segment.line;
+            if (new_line) {
+                lines_.push_back(segment.line);
+                line_starts_.push_back(static_cast<std::uint32_t>(begins_.size()));
+            }
+            begins_.push_back(segment.begin);
+            roads_.push_back(segment.road);
+            if (new_line || segment.end > reaches_.back()) {
+                reaches_.push_back(segment.end);
+                reach_roads_.push_back(segment.road);
+            }
+            else {
+                reaches_.push_back(reaches_.back());
+                reach_roads_.push_back(reach_roads_.back());
+            }
+        }
+        line_starts_.push_back(static_cast<std::uint32_t>(begins_.size()));
+    }
+
+    std::optional<size_t> RoadIndex::AxisRoads::FindAt(Coord line, Coord along) const noexcept {
+        const auto line_it = std::lower_bound(lines_.begin(), lines_.end(), line);
+        if (line_it == lines_.end() || *line_it != line) {
+            return std::nullopt;
+        }
+        const auto line_index = static_cast<size_t>(line_it - lines_.begin());
+        const auto first = begins_.begin() + line_starts_[line_index];
+        const auto last = begins_.begin() + line_starts_[line_index + 1];
+
+        // Последний отрезок, начинающийся не правее along. Если точку покрывает хоть один отрезок
+        // линии, то её покрывает и тот, на котором достигается reaches_
+        const auto it = std::upper_bound(first, last, along);
+        if (it == first) {
+            return std::nullopt;
+        }
+        const auto index = static_cast<size_t>(it - begins_.begin()) - 1;
+        if (reaches_[index] < along) {
+            return std::nullopt;
+        }
+        return reach_roads_[index];
+    }
+
+    RoadIndex::Candidate RoadIndex::AxisRoads::FindNearestOnLine(size_t line_index, Coord line, Coord along) const noexcept {
+        const auto first = begins_.begin() + line_starts_[line_index];
+        const auto last = begins_.begin() + line_starts_[line_index + 1];
+        const auto it = std::upper_bound(first, last, along);
+
+        // Среди отрезков, начинающихся не правее along, ближе всех тот, что дальше всех тянется вправо.
+        // Среди остальных - первый из них
+        std::optional<Candidate> best;
+        if (it != first) {
+            const auto index = static_cast<size_t>(it - begins_.begin()) - 1;
+            const Coord closest = std::min(reaches_[index], along);
+            best = Candidate{ static_cast<double>(along) - closest, reach_roads_[index], line, closest };
+        }
+        if (it != last) {
+            const auto index = static_cast<size_t>(it - begins_.begin());
+            const double distance = static_cast<double>(begins_[index]) - along;
+            if (!best || distance < best->squared_distance) {
+                best = Candidate{ distance, roads_[index], line, begins_[index] };
+            }
+        }
+        // Пока в squared_distance лежало расстояние вдоль линии, возводим в квадрат в конце
+        best->squared_distance *= best->squared_distance;
+        return *best;
+    }
+
+    void RoadIndex::AxisRoads::FindNearest(Coord line, Coord along, std::optional<Candidate>& best) const noexcept {
+        // Идём по линиям в обе стороны от line, каждый раз выбирая более близкую
+        auto above = static_cast<size_t>(std::lower_bound(lines_.begin(), lines_.end(), line) - lines_.begin());
+        auto below = above;
+        while (above < lines_.size() || below > 0) {
+            const double above_distance = above < lines_.size() ? static_cast<double>(lines_[above]) - line : HUGE_VAL;
+            const double below_distance = below > 0 ? static_cast<double>(line) - lines_[below - 1] : HUGE_VAL;
+            const bool take_above = above_distance <= below_distance;
+            const double line_distance = take_above ? above_distance : below_distance;
+            if (best && line_distance * line_distance >= best->squared_distance) {
+                return;
+            }
+            const size_t line_index = take_above ? above++ : --below;
+
+            auto candidate = FindNearestOnLine(line_index, lines_[line_index], along);
+            candidate.squared_distance += line_distance * line_distance;
+            if (!best || candidate.squared_distance < best->squared_distance) {
+                best = candidate;
+            }
+        }
+    }
+
+    RoadIndex::RoadIndex(const std::vector<Road>& roads) {
+        std::vector<AxisRoads::Segment> horizontal;
+        std::vector<AxisRoads::Segment> vertical;
+        for (size_t i = 0; i < roads.size(); ++i) {
+            const auto start = roads[i].GetStart();
+            const auto end = roads[i].GetEnd();
+            const auto road = static_cast<std::uint32_t>(i);
+            if (roads[i].IsHorizontal()) {
+                horizontal.push_back({ start.y, std::min(start.x, end.x), std::max(start.x, end.x), road });
+            }
+            else {
+                vertical.push_back({ start.x, std::min(start.y, end.y), std::max(start.y, end.y), road });
+            }
+        }
+        horizontal_ = AxisRoads{ std::move(horizontal) };
+        vertical_ = AxisRoads{ std::move(vertical) };
+    }
+
+    std::optional<size_t> RoadIndex::FindRoadAt(Point point) const noexcept {
+        if (auto road = horizontal_.FindAt(point.y, point.x)) {
+            return road;
+        }
+        return vertical_.FindAt(point.x, point.y);
+    }
+
+    std::optional<RoadIndex::NearestRoad> RoadIndex::FindNearestRoad(Point point) const noexcept {
+        std::optional<Candidate> horizontal;
+        horizontal_.FindNearest(point.y, point.x, horizontal);
+        std::optional<Candidate> vertical = horizontal;
+        vertical_.FindNearest(point.x, point.y, vertical);
+
+        // Если вертикальная дорога не оказалась строго ближе, vertical остался равен horizontal
+        if (vertical && (!horizontal || vertical->squared_distance < horizontal->squared_distance)) {
+            return NearestRoad{ vertical->road, Point{ vertical->line, vertical->along }, std::sqrt(vertical->squared_distance) };
+        }
+        if (horizontal) {
+            return NearestRoad{ horizontal->road, Point{ horizontal->along, horizontal->line }, std::sqrt(horizontal->squared_distance) };
+        }
+        return std::nullopt;
+    }
+
+    namespace {
+        // Элементов на ячейку в среднем. Меньше - больше пустых ячеек при поиске, больше - длиннее ячейки
+        constexpr double ITEMS_PER_CELL = 2.0;
+        // Ограничение числа ячеек относительно числа элементов, чтобы вытянутые карты не раздували сетку
+        constexpr std::int64_t MAX_CELLS_PER_ITEM = 4;
+
+        SpatialGrid::Box ToBox(const Rectangle& rectangle) noexcept {
+            const Coord x0 = rectangle.position.x;
+            const Coord y0 = rectangle.position.y;
+            const Coord x1 = x0 + rectangle.size.width;
+            const Coord y1 = y0 + rectangle.size.height;
+            return { std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1) };
+        }
+
+        std::int64_t FloorDiv(std::int64_t value, std::int64_t divisor) noexcept {
+            const auto quotient = value / divisor;
+            return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+        }
+    }  // namespace
+
+    SpatialGrid::SpatialGrid(std::vector<Box> boxes)
+        : boxes_{ std::move(boxes) } {
+        if (boxes_.empty()) {
+            return;
+        }
+
+        Box bounds = boxes_.front();
+        double item_extent = 0;
+        for (const auto& box : boxes_) {
+            bounds = { std::min(bounds.min_x, box.min_x), std::min(bounds.min_y, box.min_y),
+                       std::max(bounds.max_x, box.max_x), std::max(bounds.max_y, box.max_y) };
+            item_extent += std::max<double>(static_cast<double>(box.max_x) - box.min_x, static_cast<double>(box.max_y) - box.min_y);
+        }
+        origin_x_ = bounds.min_x;
+        origin_y_ = bounds.min_y;
+
+        // Ячейка не меньше среднего элемента, иначе крупные элементы копировались бы во множество ячеек
+        const double width = static_cast<double>(bounds.max_x) - bounds.min_x + 1;
+        const double height = static_cast<double>(bounds.max_y) - bounds.min_y + 1;
+        const auto count = static_cast<double>(boxes_.size());
+        double cell_size = std::max(std::sqrt(width * height * ITEMS_PER_CELL / count), item_extent / count);
+        const auto max_cells = static_cast<double>(MAX_CELLS_PER_ITEM * static_cast<std::int64_t>(boxes_.size()));
+        while (std::ceil(width / cell_size) * std::ceil(height / cell_size) > max_cells) {
+            cell_size *= 1.5;
+        }
+        cell_size_ = std::max<std::int64_t>(1, static_cast<std::int64_t>(std::ceil(cell_size)));
+        columns_ = CellX(bounds.max_x) + 1;
+        rows_ = CellY(bounds.max_y) + 1;
+
+        // Два прохода: подсчёт элементов в ячейках, затем раскладка по отрезкам
+        cell_starts_.assign(static_cast<size_t>(columns_ * rows_ + 1), 0);
+        const auto for_each_cell = [this](const Box& box, auto&& fn) {
+            for (auto y = CellY(box.min_y), last_y = CellY(box.max_y); y <= last_y; ++y) {
+                for (auto x = CellX(box.min_x), last_x = CellX(box.max_x); x <= last_x; ++x) {
+                    fn(static_cast<size_t>(y * columns_ + x));
+                }
+            }
+        };
+        for (const auto& box : boxes_) {
+            for_each_cell(box, [this](size_t cell) {
+                ++cell_starts_[cell + 1];
+                });
+        }
+        for (size_t i = 1; i < cell_starts_.size(); ++i) {
+            cell_starts_[i] += cell_starts_[i - 1];
+        }
+        cell_items_.resize(cell_starts_.back());
+        auto fill = std::vector<std::uint32_t>(cell_starts_.begin(), cell_starts_.end() - 1);
+        for (size_t item = 0; item < boxes_.size(); ++item) {
+            for_each_cell(boxes_[item], [&](size_t cell) {
+                cell_items_[fill[cell]++] = static_cast<std::uint32_t>(item);
+                });
+        }
+    }
+
+    SpatialGrid::CellCoord SpatialGrid::CellX(Coord x) const noexcept {
+        return FloorDiv(static_cast<std::int64_t>(x) - origin_x_, cell_size_);
+    }
+
+    SpatialGrid::CellCoord SpatialGrid::CellY(Coord y) const noexcept {
+        return FloorDiv(static_cast<std::int64_t>(y) - origin_y_, cell_size_);
+    }
+
+    double SpatialGrid::SquaredDistance(size_t item, Point point) const noexcept {
+        const auto& box = boxes_[item];
+        const double dx = std::max({ 0.0, static_cast<double>(box.min_x) - point.x, static_cast<double>(point.x) - box.max_x });
+        const double dy = std::max({ 0.0, static_cast<double>(box.min_y) - point.y, static_cast<double>(point.y) - box.max_y });
+        return dx * dx + dy * dy;
+    }
+
+    void SpatialGrid::FindIntersecting(const Box& area, std::vector<size_t>& result) const {
+        if (boxes_.empty()) {
+            return;
+        }
+        const auto first_x = std::max<CellCoord>(0, CellX(area.min_x));
+        const auto first_y = std::max<CellCoord>(0, CellY(area.min_y));
+        const auto last_x = std::min<CellCoord>(columns_ - 1, CellX(area.max_x));
+        const auto last_y = std::min<CellCoord>(rows_ - 1, CellY(area.max_y));
+        for (auto y = first_y; y <= last_y; ++y) {
+            for (auto x = first_x; x <= last_x; ++x) {
+                const auto cell = static_cast<size_t>(y * columns_ + x);
+                for (auto i = cell_starts_[cell]; i < cell_starts_[cell + 1]; ++i) {
+                    const auto item = cell_items_[i];
+                    const auto& box = boxes_[item];
+                    if (box.max_x < area.min_x || box.min_x > area.max_x || box.max_y < area.min_y || box.min_y > area.max_y) {
+                        continue;
+                    }
+                    // Элемент из нескольких ячеек выдаём только в той, где лежит левый нижний угол пересечения
+                    if (CellX(std::max(box.min_x, area.min_x)) == x && CellY(std::max(box.min_y, area.min_y)) == y) {
+                        result.push_back(item);
+                    }
+                }
+            }
+        }
+    }
+
+    std::optional<size_t> SpatialGrid::FindNearest(Point point) const noexcept {
+        if (boxes_.empty()) {
+            return std::nullopt;
+        }
+        const auto center_x = CellX(point.x);
+        const auto center_y = CellY(point.y);
+
+        // Кольца ячеек вокруг ячейки точки. Элемент, не найденный в кольцах до radius включительно,
+        // не задевает квадрат из этих ячеек, а значит, удалён от точки не меньше чем на radius ячеек
+        const auto outside = std::max({ CellCoord{ 0 }, -center_x, center_x - (columns_ - 1), -center_y, center_y - (rows_ - 1) });
+        const auto max_radius = std::max({ center_x, columns_ - 1 - center_x, center_y, rows_ - 1 - center_y });
+        std::optional<size_t> best;
+        double best_distance = 0;
+        for (auto radius = outside; radius <= max_radius; ++radius) {
+            const double ring_distance = static_cast<double>(std::max<CellCoord>(0, radius - 1)) * static_cast<double>(cell_size_);
+            if (best && best_distance < ring_distance * ring_distance) {
+                break;
+            }
+            const auto visit = [&](CellCoord x, CellCoord y) {
+                const auto cell = static_cast<size_t>(y * columns_ + x);
+                for (auto i = cell_starts_[cell]; i < cell_starts_[cell + 1]; ++i) {
+                    const auto item = cell_items_[i];
+                    const double distance = SquaredDistance(item, point);
+                    if (!best || distance < best_distance || (distance == best_distance && item < *best)) {
+                        best = item;
+                        best_distance = distance;
+                    }
+                }
+            };
+            if (radius == 0) {
+                visit(center_x, center_y);
+                continue;
+            }
+            // Стороны кольца обрезаются по границам сетки: у точки далеко за сеткой кольцо огромно,
+            // а ячеек сетки на нём - не больше, чем в её строке или столбце
+            const auto first_x = std::max<CellCoord>(0, center_x - radius);
+            const auto last_x = std::min<CellCoord>(columns_ - 1, center_x + radius);
+            const auto first_y = std::max<CellCoord>(0, center_y - radius + 1);
+            const auto last_y = std::min<CellCoord>(rows_ - 1, center_y + radius - 1);
+            for (const auto y : { center_y - radius, center_y + radius }) {
+                if (y >= 0 && y < rows_) {
+                    for (auto x = first_x; x <= last_x; ++x) {
+                        visit(x, y);
+                    }
+                }
+            }
+            for (const auto x : { center_x - radius, center_x + radius }) {
+                if (x >= 0 && x < columns_) {
+                    for (auto y = first_y; y <= last_y; ++y) {
+                        visit(x, y);
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    void Map::BuildIndex() {
+        road_index_ = RoadIndex{ roads_ };
+
+        std::vector<SpatialGrid::Box> building_boxes;
+        building_boxes.reserve(buildings_.size());
+        for (const auto& building : buildings_) {
+            building_boxes.push_back(ToBox(building.GetBounds()));
+        }
+        building_grid_ = SpatialGrid{ std::move(building_boxes) };
+
+        std::vector<SpatialGrid::Box> office_boxes;
+        office_boxes.reserve(offices_.size());
+        for (const auto& office : offices_) {
+            const auto position = office.GetPosition();
+            office_boxes.push_back({ position.x, position.y, position.x, position.y });
+        }
+        office_grid_ = SpatialGrid{ std::move(office_boxes) };
+
+        indexed_ = true;
+    }
+
+    void Map::FindBuildingsIn(const Rectangle& area, std::vector<size_t>& result) const {
+        building_grid_.FindIntersecting(ToBox(area), result);
+    }
+
+    void Map::FindOfficesIn(const Rectangle& area, std::vector<size_t>& result) const {
+        office_grid_.FindIntersecting(ToBox(area), result);
+    }
+
     void Map::AddOffice(Office office) {
         if (warehouse_id_to_index_.contains(office.GetId())) {
             throw std::invalid_argument("Duplicate warehouse");
@@ -12,6 +356,7 @@ namespace model {
 
         const size_t index = offices_.size();
         Office& o = offices_.emplace_back(std::move(office));
+        indexed_ = false;
         try {
             warehouse_id_to_index_.emplace(o.GetId(), index);
         }
@@ -23,6 +368,9 @@ namespace model {
     }
 
     void Game::AddMap(Map map) {
+        if (!map.IsIndexed()) {
+            map.BuildIndex();
+        }
         const size_t index = maps_.size();
         if (auto [it, inserted] = map_id_to_index_.emplace(map.GetId(), index); !inserted) {
             throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
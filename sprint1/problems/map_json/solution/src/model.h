@@ -1,5 +1,8 @@
 #pragma once
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -71,6 +74,110 @@ namespace model {
         Point end_;
     };
 
+    /*
+     * Индекс дорог карты для запросов "лежит ли точка на дороге" и "какая дорога ближе всего".
+     * Горизонтальные и вертикальные дороги хранятся раздельно, каждая группа - структурой массивов,
+     * упорядоченной по линии дороги (y у горизонтальных, x у вертикальных), а внутри линии - по началу
+     * отрезка. И линия, и отрезок на ней ищутся двоичным поиском.
+     */
+    class RoadIndex {
+    public:
+        struct NearestRoad {
+            size_t road;        // индекс в Map::GetRoads()
+            Point closest;      // ближайшая к запрошенной точка этой дороги
+            double distance;
+        };
+
+        RoadIndex() = default;
+        explicit RoadIndex(const std::vector<Road>& roads);
+
+        // Одна из дорог, содержащих point, - за O(log n)
+        std::optional<size_t> FindRoadAt(Point point) const noexcept;
+
+        // Ближайшая к point дорога. Линии дорог перебираются от ближайшей к point, пока расстояние
+        // до линии меньше найденного, на каждой линии поиск занимает O(log n)
+        std::optional<NearestRoad> FindNearestRoad(Point point) const noexcept;
+
+    private:
+        // Лучший на данный момент кандидат в ближайшие
+        struct Candidate {
+            double squared_distance;
+            std::uint32_t road;
+            Coord line;
+            Coord along;
+        };
+
+        // Дороги одного направления: line - неизменная вдоль дороги координата, [begin, end] - отрезок по другой
+        class AxisRoads {
+        public:
+            struct Segment {
+                Coord line;
+                Coord begin;
+                Coord end;
+                std::uint32_t road;
+            };
+
+            AxisRoads() = default;
+            explicit AxisRoads(std::vector<Segment> segments);
+
+            std::optional<size_t> FindAt(Coord line, Coord along) const noexcept;
+            void FindNearest(Coord line, Coord along, std::optional<Candidate>& best) const noexcept;
+
+        private:
+            // Ближайший к along отрезок линии line_index
+            Candidate FindNearestOnLine(size_t line_index, Coord line, Coord along) const noexcept;
+
+            std::vector<Coord> lines_;                  // различные значения line по возрастанию
+            std::vector<std::uint32_t> line_starts_;    // отрезки линии i - [line_starts_[i], line_starts_[i + 1])
+            std::vector<Coord> begins_;
+            std::vector<Coord> reaches_;                // наибольший end среди отрезков линии от первого до текущего
+            std::vector<std::uint32_t> reach_roads_;    // дорога, на которой достигается reaches_
+            std::vector<std::uint32_t> roads_;
+        };
+
+        AxisRoads horizontal_;
+        AxisRoads vertical_;
+    };
+
+    /*
+     * Равномерная сетка над прямоугольниками (точка - прямоугольник нулевого размера).
+     * Ячейки хранятся в сжатом виде: элементы всех ячеек лежат подряд в одном массиве, а для каждой
+     * ячейки известно начало её отрезка. Элемент, задевающий несколько ячеек, записан в каждую из них.
+     * Размер ячейки подбирается так, чтобы на ячейку приходилось несколько элементов, поэтому запрос
+     * в окрестности точки просматривает небольшое постоянное число ячеек.
+     */
+    class SpatialGrid {
+    public:
+        struct Box {
+            Coord min_x, min_y, max_x, max_y;
+        };
+
+        SpatialGrid() = default;
+        explicit SpatialGrid(std::vector<Box> boxes);
+
+        // Добавляет в result номера элементов, пересекающих area (границы включаются), каждый по одному разу
+        void FindIntersecting(const Box& area, std::vector<size_t>& result) const;
+
+        // Номер ближайшего к point элемента (расстояние до прямоугольника, 0 - если point внутри)
+        std::optional<size_t> FindNearest(Point point) const noexcept;
+
+    private:
+        using CellCoord = std::int64_t;
+
+        CellCoord CellX(Coord x) const noexcept;
+        CellCoord CellY(Coord y) const noexcept;
+        double SquaredDistance(size_t item, Point point) const noexcept;
+
+        std::vector<Box> boxes_;
+        Coord origin_x_ = 0;
+        Coord origin_y_ = 0;
+        std::int64_t cell_size_ = 1;
+        CellCoord columns_ = 0;
+        CellCoord rows_ = 0;
+        std::vector<std::uint32_t> cell_starts_;    // элементы ячейки i - [cell_starts_[i], cell_starts_[i + 1])
+        std::vector<std::uint32_t> cell_items_;
+    };
+
     class Building {
     public:
         explicit Building(Rectangle bounds) noexcept
@@ -147,24 +254,78 @@ namespace model {
 
         void AddRoad(const Road& road) {
             roads_.emplace_back(road);
+            indexed_ = false;
+        }
+
+        // Строит индексы по добавленным элементам. Game::AddMap вызывает его сам, если индексы
+        // не построены заранее. До этого запросы к индексам карты возвращают пустой результат
+        void BuildIndex();
+
+        bool IsIndexed() const noexcept {
+            return indexed_;
+        }
+
+        const Road* FindRoadAt(Point point) const noexcept {
+            const auto road = road_index_.FindRoadAt(point);
+            return road ? &roads_[*road] : nullptr;
+        }
+
+        std::optional<RoadIndex::NearestRoad> FindNearestRoad(Point point) const noexcept {
+            return road_index_.FindNearestRoad(point);
+        }
+
+        // Добавляют в result индексы зданий (офисов), пересекающих area, включая границу
+        void FindBuildingsIn(const Rectangle& area, std::vector<size_t>& result) const;
+        void FindOfficesIn(const Rectangle& area, std::vector<size_t>& result) const;
+
+        // Ближайшие к point здание и офис. Расстояние до здания - до его границы, 0 - если point внутри
+        const Building* FindNearestBuilding(Point point) const noexcept {
+            const auto building = building_grid_.FindNearest(point);
+            return building ? &buildings_[*building] : nullptr;
+        }
+
+        const Office* FindNearestOffice(Point point) const noexcept {
+            const auto office = office_grid_.FindNearest(point);
+            return office ? &offices_[*office] : nullptr;
         }
 
         void AddBuilding(const Building& building) {
             buildings_.emplace_back(building);
+            indexed_ = false;
         }
 
         void AddOffice(Office office);
 
+        void Reserve(size_t roads, size_t buildings, size_t offices) {
+            roads_.reserve(roads);
+            buildings_.reserve(buildings);
+            offices_.reserve(offices);
+            warehouse_id_to_index_.reserve(offices);
+        }
+
+        // Поиск офиса по id без создания Office::Id. Возвращает nullptr, если офиса нет
+        const Office* FindOffice(std::string_view id) const noexcept {
+            if (auto it = warehouse_id_to_index_.find(id); it != warehouse_id_to_index_.end()) {
+                return &offices_[it->second];
+            }
+            return nullptr;
+        }
+
     private:
-        using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
+        using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>, util::TaggedEqual<Office::Id>>;
 
         Id id_;
         std::string name_;
         Roads roads_;
+        RoadIndex road_index_;
         Buildings buildings_;
+        SpatialGrid building_grid_;
 
         OfficeIdToIndex warehouse_id_to_index_;
         Offices offices_;
+        SpatialGrid office_grid_;
+
+        bool indexed_ = false;
     };
 
     class Game {
@@ -173,20 +334,31 @@ namespace model {
 
         void AddMap(Map map);
 
+        void ReserveMaps(size_t count) {
+            maps_.reserve(count);
+            map_id_to_index_.reserve(count);
+        }
+
         const Maps& GetMaps() const noexcept {
             return maps_;
         }
 
         const Map* FindMap(const Map::Id& id) const noexcept {
+            return FindMap(std::string_view{ *id });
+        }
+
+        // Поиск по строке - например, по сегменту пути запроса - без создания Map::Id
+        const Map* FindMap(std::string_view id) const noexcept {
             if (auto it = map_id_to_index_.find(id); it != map_id_to_index_.end()) {
-                return &maps_.at(it->second);
+                return &maps_[it->second];
             }
             return nullptr;
         }
 
     private:
         using MapIdHasher = util::TaggedHasher<Map::Id>;
-        using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
+        using MapIdEqual = util::TaggedEqual<Map::Id>;
+        using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher, MapIdEqual>;
 
         std::vector<Map> maps_;
         MapIdToIndex map_id_to_index_;
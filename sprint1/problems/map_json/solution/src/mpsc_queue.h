@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace game_tick {
+
+    /*
+     * Ограниченная очередь без блокировок: много писателей, один читатель.
+     * Кольцевой буфер ячеек с номерами последовательности (схема Д. Вьюкова): писатель
+     * занимает позицию через compare_exchange на tail_, пишет значение и публикует его,
+     * записав в ячейку номер позиции + 1. Читатель видит ячейку готовой по этому номеру
+     * и освобождает её для следующего круга. Вместимость округляется вверх до степени двойки.
+     */
+    template <typename T>
+    class BoundedMpscQueue {
+        static_assert(std::is_default_constructible_v<T> && std::is_move_assignable_v<T>);
+
+    public:
+        explicit BoundedMpscQueue(std::size_t capacity)
+            : capacity_{ std::bit_ceil(std::max<std::size_t>(capacity, 2)) }
+            , mask_{ capacity_ - 1 }
+            , cells_{ std::make_unique<Cell[]>(capacity_) } {
+            for (std::size_t i = 0; i < capacity_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+        BoundedMpscQueue& operator=(const BoundedMpscQueue&) = delete;
+
+        // Из любого потока. false - очередь заполнена, value не изменяется
+        bool TryPush(T&& value) {
+            std::size_t pos = tail_.load(std::memory_order_relaxed);
+            Cell* cell = nullptr;
+            while (true) {
+                cell = &cells_[pos & mask_];
+                const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+                if (diff == 0) {
+                    if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = tail_.load(std::memory_order_relaxed);
+                }
+            }
+            cell->value = std::move(value);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Только из потока-читателя
+        std::optional<T> TryPop() {
+            const std::size_t pos = head_.load(std::memory_order_relaxed);
+            Cell& cell = cells_[pos & mask_];
+            if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+                return std::nullopt;
+            }
+            std::optional<T> value{ std::move(cell.value) };
+            cell.value = T{};
+            cell.sequence.store(pos + capacity_, std::memory_order_release);
+            head_.store(pos + 1, std::memory_order_relaxed);
+            return value;
+        }
+
+        // Примерное число элементов: писатели могут менять его одновременно с чтением
+        std::size_t GetApproxSize() const noexcept {
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+
+        std::size_t GetCapacity() const noexcept {
+            return capacity_;
+        }
+
+    private:
+        static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+        struct Cell {
+            std::atomic<std::size_t> sequence{ 0 };
+            T value{};
+        };
+
+        const std::size_t capacity_;
+        const std::size_t mask_;
+        std::unique_ptr<Cell[]> cells_;
+        // Позиции писателей и читателя в разных кэш-линиях
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_{ 0 };
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_{ 0 };
+    };
+
+}  // namespace game_tick
@@ -2,9 +2,15 @@
 #include "http_server.h"
 #include "json_serializer.h"
 #include "model.h"
+#include "request_metrics.h"
+#include "response_cache.h"
+#include "router.h"
 
 #include <boost/json.hpp>
 
+#include <array>
+#include <chrono>
+
 namespace http_handler {
     namespace beast = boost::beast;
     namespace http = beast::http;
@@ -19,103 +25,155 @@ namespace http_handler {
     template <typename Body, typename Allocator>
     using HttpResponse = http::response<Body, http::basic_fields<Allocator>>;
 
+    // Ответы ссылаются на неизменяемые буферы кэша и отправляются без копирования тела
+    template <typename Allocator>
+    using SharedHttpResponse = HttpResponse<http_server::SharedBufferBody, Allocator>;
+
     struct ContentType {
         ContentType() = delete;
         constexpr static std::string_view TEXT_HTML = "text/html"sv;
         constexpr static std::string_view TEXT_JSON = "application/json"sv;
+        constexpr static std::string_view TEXT_PROMETHEUS = "text/plain; version=0.0.4"sv;
         // При необходимости внутрь ContentType можно добавить и другие типы контента
     };
 
+    // Значение заголовка Allow в ответе 405
+    constexpr std::string_view ALLOWED_METHODS = "GET, HEAD"sv;
+
     class RequestHandler {
     public:
-        explicit RequestHandler(model::Game& game) : game_{ game } {}
+        explicit RequestHandler(model::Game& game) : cache_{ game } {}
 
         RequestHandler(const RequestHandler&) = delete;
         RequestHandler& operator=(const RequestHandler&) = delete;
 
+        // На каждый запрос отправляется ровно один ответ: сессия отвечает на pipelined-запросы
+        // по порядку, и пропущенный ответ сдвинул бы все следующие
         template <typename Body, typename Allocator, typename Send>
         void operator()(HttpRequest<Body, Allocator>&& req, Send&& send) {
-            auto target = req.target();
-            if (req.method() == http::verb::get) {
-                send(ProcessGetResponse<Body, Allocator>(std::move(req), target));
+            const auto start = std::chrono::steady_clock::now();
+            auto route = metrics::Route::UNKNOWN;
+            const bool head = req.method() == http::verb::head;
+            auto response = head || req.method() == http::verb::get
+                ? ProcessGetResponse(req, req.target(), route)
+                : MakeMethodNotAllowedResponse(req);
+            if (head) {
+                // Те же заголовки, что у GET, включая Content-Length, но без тела
+                response.body() = nullptr;
             }
+            metrics::RecordRequest(route, response.result_int(), std::chrono::steady_clock::now() - start);
+            send(std::move(response));
         }
 
     private:
-        template <typename Body, typename Allocator>
-        HttpResponse<Body, Allocator> MakeHttpResponse(http::status status, std::string_view body, unsigned version, bool keep_alive, std::string_view ContentType_) {
-            HttpResponse<Body, Allocator> response(status, version);
+        // Заголовки ответа размещаются тем же аллокатором, что и заголовки запроса (в арене сессии)
+        template <typename Allocator>
+        SharedHttpResponse<Allocator> MakeEmptyResponse(http::status status, unsigned version, const Allocator& allocator) {
+            SharedHttpResponse<Allocator> response(std::piecewise_construct, std::make_tuple(), std::make_tuple(allocator));
+            response.result(status);
+            response.version(version);
+            return response;
+        }
+
+        template <typename Allocator>
+        SharedHttpResponse<Allocator> MakeHttpResponse(http::status status, const response_cache::CachedResponse& cached, unsigned version, bool keep_alive, std::string_view ContentType_, const Allocator& allocator) {
+            auto response = MakeEmptyResponse(status, version, allocator);
             response.set(http::field::content_type, ContentType_);
-            response.body() = body;
-            response.content_length(body.size());
+            response.body() = cached.body;
+            response.content_length(cached.content_length);
             response.keep_alive(keep_alive);
             return response;
         }
 
+        // Ответ с телом из кэша. Если клиент уже имеет актуальную версию (If-None-Match), тело не отправляется
+        template <typename Body, typename Allocator>
+        SharedHttpResponse<Allocator> MakeCachedJsonResponse(const HttpRequest<Body, Allocator>& request, const response_cache::CachedResponse& cached) {
+            if (request[http::field::if_none_match] == cached.etag) {
+                auto response = MakeEmptyResponse(http::status::not_modified, request.version(), request.get_allocator());
+                response.set(http::field::etag, cached.etag);
+                response.keep_alive(request.keep_alive());
+                return response;
+            }
 
-        template<typename Body, typename Allocator>
-        HttpResponse<Body, Allocator> ProcessGetResponse(http::request<Body, http::basic_fields<Allocator>>&& request, std::string_view target) {
-            std::string_view head_of_url = "/api/v1/maps"sv;
-
-            if (target.starts_with(head_of_url)) {
-                if (target == head_of_url) { //Хотим отправить все карты
-                    return MakeHttpResponse<Body, Allocator>(
-                        http::status::ok,
-                        json::serialize(SerializeAllMaps(game_.GetMaps())),
-                        request.version(),
-                        request.keep_alive(),
-                        ContentType::TEXT_JSON
-                        );
-                }   
-                else {
-                    std::string map_name(target.begin() + head_of_url.size() + 1, target.end());
-
-                    if (std::count(map_name.begin(), map_name.end(), '/')) { //Пока не известный Get запрос
-                        return MakeHttpResponse<Body, Allocator>(
-                            http::status::bad_request,
-                            json::serialize(SerializeError("badRequest"sv, "Bad request"sv)),
-                            request.version(),
-                            request.keep_alive(),
-                            ContentType::TEXT_JSON
-                            );
-                    }
-
-                    auto map_id = model::Map::Id(std::string{ map_name });
-                    const auto* map_ptr = game_.FindMap(map_id);
-
-                    if (map_ptr != nullptr) { //Юху - карта нашлась
-                        return MakeHttpResponse<Body, Allocator>(
-                            http::status::ok,
-                            json::serialize(SerializeCurrentMap(*map_ptr)),
-                            request.version(),
-                            request.keep_alive(),
-                            ContentType::TEXT_JSON
-                            );
-                    }
-                    else { //Таковой карты нет в БД
-                        return MakeHttpResponse<Body, Allocator>(
-                            http::status::not_found,
-                            json::serialize(SerializeError("mapNotFound"sv, "Map not found"sv)),
-                            request.version(),
-                            request.keep_alive(),
-                            ContentType::TEXT_JSON
-                            );
-                    }
-                }
+            auto response = MakeHttpResponse<Allocator>(http::status::ok, cached, request.version(), request.keep_alive(), ContentType::TEXT_JSON, request.get_allocator());
+            response.set(http::field::etag, cached.etag);
+            return response;
+        }
+
+        template <typename Body, typename Allocator>
+        SharedHttpResponse<Allocator> MakeMethodNotAllowedResponse(const HttpRequest<Body, Allocator>& request) {
+            auto response = MakeHttpResponse(http::status::method_not_allowed, cache_.GetSnapshot().GetMethodNotAllowed(), request.version(),
+                request.keep_alive(), ContentType::TEXT_JSON, request.get_allocator());
+            response.set(http::field::allow, ALLOWED_METHODS);
+            return response;
+        }
+
+        // Метрики собираются в момент запроса, поэтому тело ответа не кэшируется
+        template <typename Body, typename Allocator>
+        SharedHttpResponse<Allocator> MakeMetricsResponse(const HttpRequest<Body, Allocator>& request) {
+            auto body = http_server::MakeSharedBuffer(metrics::ScrapePrometheus());
+            const response_cache::CachedResponse scraped{ body, body->size(), {} };
+            return MakeHttpResponse(http::status::ok, scraped, request.version(), request.keep_alive(), ContentType::TEXT_PROMETHEUS, request.get_allocator());
+        }
+
+        // Обработчики GET-запросов. captures - значения {параметров} из шаблона маршрута
+        template <typename Body, typename Allocator>
+        SharedHttpResponse<Allocator> GetMapsList(const HttpRequest<Body, Allocator>& request, [[maybe_unused]] const router::Captures& captures) {
+            return MakeCachedJsonResponse(request, cache_.GetSnapshot().GetMapsList());
+        }
+
+        template <typename Body, typename Allocator>
+        SharedHttpResponse<Allocator> GetMap(const HttpRequest<Body, Allocator>& request, const router::Captures& captures) {
+            const auto& snapshot = cache_.GetSnapshot();
+            if (const auto* cached_map = snapshot.FindMap(captures[0])) { //Юху - карта нашлась
+                return MakeCachedJsonResponse(request, *cached_map);
             }
-            else { //Хотим отправить bad_request
-                return MakeHttpResponse<Body, Allocator>(
-                    http::status::bad_request,
-                    json::serialize(SerializeError("badRequest"sv, "Bad request"sv)),
-                    request.version(),
-                    request.keep_alive(),
-                    ContentType::TEXT_JSON
-                    );
+            //Таковой карты нет в БД
+            return MakeHttpResponse(http::status::not_found, snapshot.GetMapNotFound(), request.version(), request.keep_alive(),
+                ContentType::TEXT_JSON, request.get_allocator());
+        }
+
+        template <typename Body, typename Allocator>
+        SharedHttpResponse<Allocator> GetMetrics(const HttpRequest<Body, Allocator>& request, [[maybe_unused]] const router::Captures& captures) {
+            return MakeMetricsResponse(request);
+        }
+
+        template <typename Body, typename Allocator>
+        using GetHandler = SharedHttpResponse<Allocator>(RequestHandler::*)(const HttpRequest<Body, Allocator>&, const router::Captures&);
+
+        template <typename Body, typename Allocator>
+        struct GetRoute {
+            std::string_view pattern;
+            metrics::Route metric;
+            GetHandler<Body, Allocator> handler;
+        };
+
+        // Таблица GET-маршрутов. Новый эндпоинт - это новая строка здесь и метод-обработчик
+        template <typename Body, typename Allocator>
+        static constexpr std::array GET_ROUTES = {
+            GetRoute<Body, Allocator>{ "/api/v1/maps"sv, metrics::Route::MAPS_LIST, &RequestHandler::GetMapsList<Body, Allocator> },
+            GetRoute<Body, Allocator>{ "/api/v1/maps/{id}"sv, metrics::Route::MAP, &RequestHandler::GetMap<Body, Allocator> },
+            GetRoute<Body, Allocator>{ "/metrics"sv, metrics::Route::METRICS, &RequestHandler::GetMetrics<Body, Allocator> },
+        };
+
+        // В route записывается маршрут, к которому отнесён запрос - для метрик
+        template<typename Body, typename Allocator>
+        SharedHttpResponse<Allocator> ProcessGetResponse(const HttpRequest<Body, Allocator>& request, std::string_view target, metrics::Route& route) {
+            static_assert(router::AreValidPatterns(GET_ROUTES<Body, Allocator>));
+
+            router::Captures captures;
+            if (const auto* matched = router::FindRoute(GET_ROUTES<Body, Allocator>, target, captures)) {
+                route = matched->metric;
+                return (this->*matched->handler)(request, captures);
             }
+
+            //Хотим отправить bad_request
+            return MakeHttpResponse(http::status::bad_request, cache_.GetSnapshot().GetBadRequest(), request.version(), request.keep_alive(),
+                ContentType::TEXT_JSON, request.get_allocator());
         }
 
     private:
-        model::Game& game_;
+        response_cache::ResponseCache cache_; //Заранее сериализованные ответы, собранные по модели игры
     };
 
 }  // namespace http_handler
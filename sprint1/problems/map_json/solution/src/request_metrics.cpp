@@ -0,0 +1,285 @@
+#include "request_metrics.h"
+#include "latency_histogram.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace metrics {
+
+    namespace {
+        constexpr std::size_t CACHE_LINE_SIZE = 64;
+        constexpr std::size_t STATUS_SLOTS = TRACKED_STATUSES.size() + 1; // + "other"
+
+        // Границы корзин гистограмм при выгрузке, в наносекундах (от 1 мкс до 10 с)
+        constexpr std::array<std::uint64_t, 22> EXPORT_BOUNDS_NS = {
+            1'000, 2'500, 5'000, 10'000, 25'000, 50'000, 100'000, 250'000, 500'000,
+            1'000'000, 2'500'000, 5'000'000, 10'000'000, 25'000'000, 50'000'000,
+            100'000'000, 250'000'000, 500'000'000, 1'000'000'000, 2'500'000'000, 5'000'000'000, 10'000'000'000
+        };
+
+        std::size_t StatusSlot(unsigned status) noexcept {
+            for (std::size_t i = 0; i < TRACKED_STATUSES.size(); ++i) {
+                if (TRACKED_STATUSES[i] == status) {
+                    return i;
+                }
+            }
+            return TRACKED_STATUSES.size();
+        }
+
+        std::uint64_t ToNanoseconds(std::chrono::nanoseconds duration) noexcept {
+            return duration.count() > 0 ? static_cast<std::uint64_t>(duration.count()) : 0;
+        }
+
+        // Метрики, которые пишет один поток. Выравнивание не даёт наборам разных потоков делить кэш-линии
+        template <typename Counter>
+        struct alignas(CACHE_LINE_SIZE) MetricSet {
+            std::array<std::array<Counter, STATUS_SLOTS>, ROUTE_COUNT> requests{};
+            std::array<BasicLatencyHistogram<Counter>, ROUTE_COUNT> request_duration{};
+
+            Counter reads{};
+            Counter read_errors{};
+            Counter read_bytes{};
+
+            Counter writes{};
+            Counter write_errors{};
+            Counter written_bytes{};
+            Counter written_responses{};
+            BasicLatencyHistogram<Counter> write_duration{};
+
+            Counter ticks{};
+            Counter skipped_ticks{};
+            Counter tick_actions{};
+            Counter dropped_actions{};
+            BasicLatencyHistogram<Counter> tick_jitter{};
+            BasicLatencyHistogram<Counter> tick_duration{};
+        };
+
+        using ThreadMetrics = MetricSet<RelaxedCounter>;
+        using TotalMetrics = MetricSet<std::uint64_t>;
+
+        class Registry {
+        public:
+            ThreadMetrics& GetLocal() {
+                thread_local ThreadMetrics* local = nullptr;
+                if (local == nullptr) {
+                    local = &Register();
+                }
+                return *local;
+            }
+
+            // Наборы потоков живут до конца работы программы, поэтому их значения не теряются
+            std::unique_ptr<TotalMetrics> Collect() {
+                auto total = std::make_unique<TotalMetrics>();
+                std::lock_guard lock{ mutex_ };
+                for (const auto& local : thread_metrics_) {
+                    for (std::size_t route = 0; route < ROUTE_COUNT; ++route) {
+                        for (std::size_t slot = 0; slot < STATUS_SLOTS; ++slot) {
+                            total->requests[route][slot] += local->requests[route][slot];
+                        }
+                        total->request_duration[route].Merge(local->request_duration[route]);
+                    }
+                    total->reads += local->reads;
+                    total->read_errors += local->read_errors;
+                    total->read_bytes += local->read_bytes;
+                    total->writes += local->writes;
+                    total->write_errors += local->write_errors;
+                    total->written_bytes += local->written_bytes;
+                    total->written_responses += local->written_responses;
+                    total->write_duration.Merge(local->write_duration);
+                    total->ticks += local->ticks;
+                    total->skipped_ticks += local->skipped_ticks;
+                    total->tick_actions += local->tick_actions;
+                    total->dropped_actions += local->dropped_actions;
+                    total->tick_jitter.Merge(local->tick_jitter);
+                    total->tick_duration.Merge(local->tick_duration);
+                }
+                return total;
+            }
+
+        private:
+            ThreadMetrics& Register() {
+                std::lock_guard lock{ mutex_ };
+                return *thread_metrics_.emplace_back(std::make_unique<ThreadMetrics>());
+            }
+
+            std::mutex mutex_;
+            std::vector<std::unique_ptr<ThreadMetrics>> thread_metrics_;
+        };
+
+        // Глубина очереди - мгновенное значение, а не сумма по потокам, поэтому хранится отдельно
+        std::atomic<std::uint64_t> action_queue_depth{ 0 };
+        std::atomic<std::uint64_t> action_queue_max_depth{ 0 };
+
+        // Движок тактов хоть раз записал метрику. Сервер пока его не запускает, и без этой отметки
+        // /metrics отдавал бы нулевые серии тактов, неотличимые от остановившегося движка
+        std::atomic<bool> tick_engine_seen{ false };
+
+        void MarkTickEngineSeen() noexcept {
+            tick_engine_seen.store(true, std::memory_order_relaxed);
+        }
+
+        Registry& GetRegistry() {
+            static Registry registry;
+            return registry;
+        }
+
+        void WriteHeader(std::ostream& out, std::string_view name, std::string_view type, std::string_view help) {
+            out << "# HELP "sv << name << ' ' << help << '\n';
+            out << "# TYPE "sv << name << ' ' << type << '\n';
+        }
+
+        std::string FormatSeconds(std::uint64_t nanoseconds) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.9g", static_cast<double>(nanoseconds) / 1e9);
+            return buffer;
+        }
+
+        // Гистограмма Prometheus: накопительные корзины по EXPORT_BOUNDS_NS, сумма в секундах и количество
+        void WriteHistogram(std::ostream& out, std::string_view name, std::string_view labels, const LatencyHistogram& histogram) {
+            const std::string_view separator = labels.empty() ? ""sv : ","sv;
+            for (const auto bound : EXPORT_BOUNDS_NS) {
+                out << name << "_bucket{"sv << labels << separator << "le=\""sv << FormatSeconds(bound) << "\"} "sv
+                    << histogram.CountAtOrBelow(bound) << '\n';
+            }
+            out << name << "_bucket{"sv << labels << separator << "le=\"+Inf\"} "sv << histogram.GetTotalCount() << '\n';
+            out << name << "_sum"sv;
+            if (!labels.empty()) {
+                out << '{' << labels << '}';
+            }
+            out << ' ' << FormatSeconds(histogram.GetSum()) << '\n';
+            out << name << "_count"sv;
+            if (!labels.empty()) {
+                out << '{' << labels << '}';
+            }
+            out << ' ' << histogram.GetTotalCount() << '\n';
+        }
+    }  // namespace
+
+    void RecordRequest(Route route, unsigned status, std::chrono::nanoseconds duration) noexcept {
+        auto& local = GetRegistry().GetLocal();
+        const auto route_index = static_cast<std::size_t>(route);
+        ++local.requests[route_index][StatusSlot(status)];
+        local.request_duration[route_index].Record(ToNanoseconds(duration));
+    }
+
+    void RecordRead(std::size_t bytes, bool ok) noexcept {
+        auto& local = GetRegistry().GetLocal();
+        ++local.reads;
+        local.read_bytes += bytes;
+        if (!ok) {
+            ++local.read_errors;
+        }
+    }
+
+    void RecordWrite(std::size_t bytes, std::size_t responses, std::chrono::nanoseconds duration, bool ok) noexcept {
+        auto& local = GetRegistry().GetLocal();
+        ++local.writes;
+        local.written_bytes += bytes;
+        local.written_responses += responses;
+        local.write_duration.Record(ToNanoseconds(duration));
+        if (!ok) {
+            ++local.write_errors;
+        }
+    }
+
+    void RecordTick(std::chrono::nanoseconds jitter, std::chrono::nanoseconds duration, std::size_t actions) noexcept {
+        MarkTickEngineSeen();
+        auto& local = GetRegistry().GetLocal();
+        ++local.ticks;
+        local.tick_actions += actions;
+        local.tick_jitter.Record(ToNanoseconds(jitter));
+        local.tick_duration.Record(ToNanoseconds(duration));
+    }
+
+    void RecordSkippedTicks(std::uint64_t count) noexcept {
+        MarkTickEngineSeen();
+        GetRegistry().GetLocal().skipped_ticks += count;
+    }
+
+    void RecordActionQueueDepth(std::size_t depth) noexcept {
+        MarkTickEngineSeen();
+        action_queue_depth.store(depth, std::memory_order_relaxed);
+        std::uint64_t max_depth = action_queue_max_depth.load(std::memory_order_relaxed);
+        while (depth > max_depth
+            && !action_queue_max_depth.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed)) {
+        }
+    }
+
+    void RecordDroppedAction() noexcept {
+        MarkTickEngineSeen();
+        ++GetRegistry().GetLocal().dropped_actions;
+    }
+
+    std::string ScrapePrometheus() {
+        const auto total = GetRegistry().Collect();
+        std::ostringstream out;
+
+        WriteHeader(out, "game_server_requests_total"sv, "counter"sv, "HTTP requests handled, by route and status."sv);
+        for (std::size_t route = 0; route < ROUTE_COUNT; ++route) {
+            for (std::size_t slot = 0; slot < STATUS_SLOTS; ++slot) {
+                out << "game_server_requests_total{route=\""sv << ROUTE_LABELS[route] << "\",status=\""sv;
+                if (slot < TRACKED_STATUSES.size()) {
+                    out << TRACKED_STATUSES[slot];
+                }
+                else {
+                    out << "other"sv;
+                }
+                out << "\"} "sv << total->requests[route][slot] << '\n';
+            }
+        }
+
+        WriteHeader(out, "game_server_request_duration_seconds"sv, "histogram"sv, "Time spent building a response, by route."sv);
+        for (std::size_t route = 0; route < ROUTE_COUNT; ++route) {
+            const std::string labels = "route=\""s + std::string{ ROUTE_LABELS[route] } + "\""s;
+            WriteHistogram(out, "game_server_request_duration_seconds"sv, labels, total->request_duration[route]);
+        }
+
+        WriteHeader(out, "game_server_reads_total"sv, "counter"sv, "Completed session reads."sv);
+        out << "game_server_reads_total " << total->reads << '\n';
+        WriteHeader(out, "game_server_read_errors_total"sv, "counter"sv, "Session reads that ended with an error, including client disconnects."sv);
+        out << "game_server_read_errors_total " << total->read_errors << '\n';
+        WriteHeader(out, "game_server_read_bytes_total"sv, "counter"sv, "Bytes consumed by session reads."sv);
+        out << "game_server_read_bytes_total " << total->read_bytes << '\n';
+
+        WriteHeader(out, "game_server_writes_total"sv, "counter"sv, "Completed session writes, one per batch of responses."sv);
+        out << "game_server_writes_total " << total->writes << '\n';
+        WriteHeader(out, "game_server_write_errors_total"sv, "counter"sv, "Session writes that ended with an error."sv);
+        out << "game_server_write_errors_total " << total->write_errors << '\n';
+        WriteHeader(out, "game_server_written_bytes_total"sv, "counter"sv, "Bytes written to clients."sv);
+        out << "game_server_written_bytes_total " << total->written_bytes << '\n';
+        WriteHeader(out, "game_server_written_responses_total"sv, "counter"sv, "Responses written to clients."sv);
+        out << "game_server_written_responses_total " << total->written_responses << '\n';
+
+        WriteHeader(out, "game_server_write_duration_seconds"sv, "histogram"sv, "Time from starting a batch write to its completion."sv);
+        WriteHistogram(out, "game_server_write_duration_seconds"sv, ""sv, total->write_duration);
+
+        if (!tick_engine_seen.load(std::memory_order_relaxed)) {
+            return out.str();
+        }
+
+        WriteHeader(out, "game_server_ticks_total"sv, "counter"sv, "Game ticks computed."sv);
+        out << "game_server_ticks_total " << total->ticks << '\n';
+        WriteHeader(out, "game_server_skipped_ticks_total"sv, "counter"sv, "Tick slots skipped because the previous tick overran its period."sv);
+        out << "game_server_skipped_ticks_total " << total->skipped_ticks << '\n';
+        WriteHeader(out, "game_server_tick_actions_total"sv, "counter"sv, "Player actions applied by ticks."sv);
+        out << "game_server_tick_actions_total " << total->tick_actions << '\n';
+        WriteHeader(out, "game_server_dropped_actions_total"sv, "counter"sv, "Player actions rejected because the action queue was full."sv);
+        out << "game_server_dropped_actions_total " << total->dropped_actions << '\n';
+        WriteHeader(out, "game_server_action_queue_depth"sv, "gauge"sv, "Player actions waiting at the start of the last tick."sv);
+        out << "game_server_action_queue_depth " << action_queue_depth.load(std::memory_order_relaxed) << '\n';
+        WriteHeader(out, "game_server_action_queue_max_depth"sv, "gauge"sv, "Largest action queue depth seen at the start of a tick."sv);
+        out << "game_server_action_queue_max_depth " << action_queue_max_depth.load(std::memory_order_relaxed) << '\n';
+
+        WriteHeader(out, "game_server_tick_jitter_seconds"sv, "histogram"sv, "Delay of a tick start relative to its schedule."sv);
+        WriteHistogram(out, "game_server_tick_jitter_seconds"sv, ""sv, total->tick_jitter);
+        WriteHeader(out, "game_server_tick_duration_seconds"sv, "histogram"sv, "Time spent computing a tick."sv);
+        WriteHistogram(out, "game_server_tick_duration_seconds"sv, ""sv, total->tick_duration);
+
+        return out.str();
+    }
+
+}  // namespace metrics
@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace metrics {
+
+    using namespace std::literals;
+
+    // Маршруты, по которым раздельно считаются запросы и их задержки
+    enum class Route : std::uint8_t {
+        MAPS_LIST,
+        MAP,
+        METRICS,
+        UNKNOWN,
+    };
+
+    inline constexpr std::size_t ROUTE_COUNT = 4;
+    inline constexpr std::array<std::string_view, ROUTE_COUNT> ROUTE_LABELS = {
+        "/api/v1/maps"sv, "/api/v1/maps/{id}"sv, "/metrics"sv, "unknown"sv
+    };
+
+    // Коды статуса с отдельными счётчиками. Остальные учитываются с меткой status="other"
+    inline constexpr std::array<unsigned, 6> TRACKED_STATUSES = { 200, 304, 400, 404, 405, 500 };
+
+    /*
+     * Запись метрик на горячем пути не берёт блокировок: каждый поток пишет в собственный
+     * выровненный по кэш-линии набор счётчиков и гистограмм. Мьютекс захватывается только
+     * при первой записи из нового потока и при выгрузке, которая суммирует наборы всех потоков.
+     */
+
+    // Запрос, обработанный RequestHandler: маршрут, итоговый статус и время формирования ответа
+    void RecordRequest(Route route, unsigned status, std::chrono::nanoseconds duration) noexcept;
+
+    // Завершение чтения запроса сессией
+    void RecordRead(std::size_t bytes, bool ok) noexcept;
+
+    // Завершение записи пакета из responses ответов, duration - от начала записи до её окончания
+    void RecordWrite(std::size_t bytes, std::size_t responses, std::chrono::nanoseconds duration, bool ok) noexcept;
+
+    // Такт движка игры: отставание начала такта от расписания, время расчёта такта и число применённых действий
+    void RecordTick(std::chrono::nanoseconds jitter, std::chrono::nanoseconds duration, std::size_t actions) noexcept;
+
+    // Такты, пропущенные из-за того, что предыдущий не уложился в период
+    void RecordSkippedTicks(std::uint64_t count) noexcept;
+
+    // Глубина очереди действий игроков в начале такта
+    void RecordActionQueueDepth(std::size_t depth) noexcept;
+
+    // Действие игрока отклонено: очередь заполнена
+    void RecordDroppedAction() noexcept;
+
+    // Текущие значения всех метрик в текстовом формате Prometheus. Серии движка тактов выводятся,
+    // только если какая-нибудь из функций Record* для тактов и очереди действий уже вызывалась
+    std::string ScrapePrometheus();
+
+}  // namespace metrics
@@ -0,0 +1,45 @@
+#include "response_cache.h"
+#include "json_serializer.h"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace response_cache {
+    using namespace std::literals;
+    namespace json = boost::json;
+
+    namespace {
+        CachedResponse MakeCachedResponse(const json::value& value) {
+            CachedResponse response;
+            response.body = http_server::MakeSharedBuffer(json::serialize(value));
+            response.content_length = response.body->size();
+            response.etag = MakeETag(*response.body);
+            return response;
+        }
+    }  // namespace
+
+    std::string MakeETag(std::string_view body) {
+        // 64-битный FNV-1a: хеш зависит только от байтов тела и не меняется между запусками сервера
+        std::uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : body) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+
+        char etag[19];
+        std::snprintf(etag, sizeof(etag), "\"%016llx\"", static_cast<unsigned long long>(hash));
+        return etag;
+    }
+
+    Snapshot::Snapshot(const model::Game& game)
+        : maps_list_{ MakeCachedResponse(json_serializer::SerializeAllMaps(game.GetMaps())) }
+        , bad_request_{ MakeCachedResponse(json_serializer::SerializeError("badRequest"sv, "Bad request"sv)) }
+        , map_not_found_{ MakeCachedResponse(json_serializer::SerializeError("mapNotFound"sv, "Map not found"sv)) }
+        , method_not_allowed_{ MakeCachedResponse(json_serializer::SerializeError("invalidMethod"sv, "Only GET and HEAD methods are expected"sv)) } {
+        maps_.reserve(game.GetMaps().size());
+        for (const auto& map : game.GetMaps()) {
+            maps_.emplace(*map.GetId(), MakeCachedResponse(json_serializer::SerializeCurrentMap(map)));
+        }
+    }
+
+}  // namespace response_cache
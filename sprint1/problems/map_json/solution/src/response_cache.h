@@ -0,0 +1,94 @@
+#pragma once
+#include "model.h"
+#include "shared_buffer_body.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace response_cache {
+
+    // Готовое к отправке тело ответа вместе с его длиной и строгим ETag.
+    // Тело разделяется между всеми ответами и в сокет передаётся без копирования
+    struct CachedResponse {
+        http_server::SharedBuffer body;
+        std::size_t content_length = 0;
+        std::string etag;
+    };
+
+    // Хешер строк, позволяющий искать в unordered_map по std::string_view без создания std::string
+    struct StringHasher {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view value) const noexcept {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    // Неизменяемый набор заранее сериализованных ответов для одной версии модели игры
+    class Snapshot {
+    public:
+        explicit Snapshot(const model::Game& game);
+
+        const CachedResponse& GetMapsList() const noexcept {
+            return maps_list_;
+        }
+
+        // Возвращает nullptr, если карты с таким id нет
+        const CachedResponse* FindMap(std::string_view id) const noexcept {
+            if (auto it = maps_.find(id); it != maps_.end()) {
+                return &it->second;
+            }
+            return nullptr;
+        }
+
+        const CachedResponse& GetBadRequest() const noexcept {
+            return bad_request_;
+        }
+
+        const CachedResponse& GetMapNotFound() const noexcept {
+            return map_not_found_;
+        }
+
+        const CachedResponse& GetMethodNotAllowed() const noexcept {
+            return method_not_allowed_;
+        }
+
+    private:
+        using MapIdToResponse = std::unordered_map<std::string, CachedResponse, StringHasher, std::equal_to<>>;
+
+        CachedResponse maps_list_;
+        MapIdToResponse maps_;
+        CachedResponse bad_request_;
+        CachedResponse map_not_found_;
+        CachedResponse method_not_allowed_;
+    };
+
+    /*
+     * Кэш ответов на запросы к /api/v1/maps и /api/v1/maps/{id}.
+     * Модель игры после загрузки не меняется, поэтому все тела ответов сериализуются один раз
+     * при создании кэша, а обработчики только читают их - без блокировок.
+     */
+    class ResponseCache {
+    public:
+        explicit ResponseCache(const model::Game& game)
+            : snapshot_{ game } {
+        }
+
+        ResponseCache(const ResponseCache&) = delete;
+        ResponseCache& operator=(const ResponseCache&) = delete;
+
+        const Snapshot& GetSnapshot() const noexcept {
+            return snapshot_;
+        }
+
+    private:
+        const Snapshot snapshot_;
+    };
+
+    // Строгий ETag (в кавычках), вычисляемый по содержимому тела ответа
+    std::string MakeETag(std::string_view body);
+
+}  // namespace response_cache
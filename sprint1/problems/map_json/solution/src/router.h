@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace router {
+
+    using namespace std::literals;
+
+    /*
+     * Маршрутизация по шаблонам путей вида "/api/v1/maps/{id}".
+     * Шаблон состоит из сегментов, разделённых '/'. Сегмент в фигурных скобках захватывает
+     * любой сегмент пути (в том числе пустой), остальные сегменты должны совпасть буквально.
+     * Сопоставление идёт по std::string_view без аллокаций и может выполняться при компиляции,
+     * поэтому корректность таблицы маршрутов проверяется static_assert.
+     */
+
+    inline constexpr std::size_t MAX_CAPTURES = 4;
+
+    // Значения захваченных сегментов в порядке их следования в шаблоне. Ссылаются на исходный путь
+    using Captures = std::array<std::string_view, MAX_CAPTURES>;
+
+    namespace detail {
+        // Отделяет от path первый сегмент. path должен начинаться с '/', который тоже отбрасывается
+        constexpr bool PopSegment(std::string_view& path, std::string_view& segment) noexcept {
+            if (!path.starts_with('/')) {
+                return false;
+            }
+            path.remove_prefix(1);
+            const auto end = path.find('/');
+            segment = path.substr(0, end);
+            path.remove_prefix(segment.size());
+            return true;
+        }
+
+        constexpr bool IsCapture(std::string_view segment) noexcept {
+            return segment.size() > 2 && segment.front() == '{' && segment.back() == '}';
+        }
+    }  // namespace detail
+
+    constexpr bool MatchPath(std::string_view pattern, std::string_view path, Captures& captures) noexcept {
+        std::size_t captured = 0;
+        std::string_view pattern_segment;
+        std::string_view path_segment;
+        while (!pattern.empty()) {
+            if (!detail::PopSegment(pattern, pattern_segment) || !detail::PopSegment(path, path_segment)) {
+                return false;
+            }
+            if (detail::IsCapture(pattern_segment)) {
+                if (captured == MAX_CAPTURES) {
+                    return false;
+                }
+                captures[captured++] = path_segment;
+            }
+            else if (pattern_segment != path_segment) {
+                return false;
+            }
+        }
+        return path.empty();
+    }
+
+    // Шаблон начинается с '/', не содержит пустых сегментов и не больше MAX_CAPTURES захватов
+    constexpr bool IsValidPattern(std::string_view pattern) noexcept {
+        if (pattern.empty()) {
+            return false;
+        }
+        std::size_t captures = 0;
+        std::string_view segment;
+        while (!pattern.empty()) {
+            if (!detail::PopSegment(pattern, segment) || segment.empty()) {
+                return false;
+            }
+            if (detail::IsCapture(segment)) {
+                ++captures;
+            }
+            else if (segment.find_first_of("{}"sv) != std::string_view::npos) {
+                return false;
+            }
+        }
+        return captures <= MAX_CAPTURES;
+    }
+
+    // Таблица маршрутов - массив записей с полем pattern. Возвращает первую подходящую запись или nullptr
+    template <typename RouteEntry, std::size_t N>
+    constexpr const RouteEntry* FindRoute(const std::array<RouteEntry, N>& routes, std::string_view path, Captures& captures) noexcept {
+        for (const auto& route : routes) {
+            if (MatchPath(route.pattern, path, captures)) {
+                return &route;
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename RouteEntry, std::size_t N>
+    constexpr bool AreValidPatterns(const std::array<RouteEntry, N>& routes) noexcept {
+        for (const auto& route : routes) {
+            if (!IsValidPattern(route.pattern)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}  // namespace router
@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+
+namespace http_server {
+
+    /*
+     * Аллокатор, через который заголовки запроса и ответа размещаются в арене сессии.
+     * std::pmr::polymorphic_allocator не подходит: Beast требует, чтобы аллокатор полей
+     * был присваиваемым, поэтому здесь хранится просто указатель на memory_resource.
+     */
+    template <typename T>
+    class BasicArenaAllocator {
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        explicit BasicArenaAllocator(std::pmr::memory_resource* resource) noexcept
+            : resource_{ resource } {
+        }
+
+        template <typename U>
+        BasicArenaAllocator(const BasicArenaAllocator<U>& other) noexcept
+            : resource_{ other.resource_ } {
+        }
+
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept {
+            resource_->deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        template <typename U>
+        bool operator==(const BasicArenaAllocator<U>& other) const noexcept {
+            return resource_ == other.resource_;
+        }
+
+    private:
+        template <typename U>
+        friend class BasicArenaAllocator;
+
+        std::pmr::memory_resource* resource_;
+    };
+
+    using ArenaAllocator = BasicArenaAllocator<char>;
+
+    /*
+     * Монотонная арена фиксированного размера, принадлежащая сессии.
+     * Память под поля запроса и ответа выделяется сдвигом указателя внутри буфера,
+     * освобождение отдельных блоков ничего не делает. Reset возвращает арену в исходное
+     * состояние между запросами keep-alive соединения. Если запросу не хватило буфера,
+     * арена временно берёт память из кучи и возвращает её при Reset.
+     */
+    class SessionArena {
+    public:
+        static constexpr std::size_t SIZE = 4096;
+
+        SessionArena() = default;
+
+        SessionArena(const SessionArena&) = delete;
+        SessionArena& operator=(const SessionArena&) = delete;
+
+        ArenaAllocator GetAllocator() noexcept {
+            return ArenaAllocator{ &resource_ };
+        }
+
+        // Вызывать только когда в арене не осталось живых объектов
+        void Reset() noexcept {
+            resource_.release();
+        }
+
+    private:
+        alignas(std::max_align_t) std::array<std::byte, SIZE> buffer_;
+        std::pmr::monotonic_buffer_resource resource_{ buffer_.data(), buffer_.size(), std::pmr::new_delete_resource() };
+    };
+
+}  // namespace http_server
@@ -0,0 +1,67 @@
+#pragma once
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace http_server {
+
+    namespace net = boost::asio;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+
+    // Неизменяемый буфер с подсчётом ссылок: одно тело разделяют все ответы, которые его отправляют
+    using SharedBuffer = std::shared_ptr<const std::string>;
+
+    inline SharedBuffer MakeSharedBuffer(std::string data) {
+        return std::make_shared<const std::string>(std::move(data));
+    }
+
+    /*
+     * Тело HTTP-ответа, которое не владеет данными, а ссылается на SharedBuffer.
+     * При отправке байты буфера передаются в сокет как есть (const_buffer), без копирования:
+     * сериализатор Beast собирает заголовок и тело в одну gather-операцию записи.
+     * Тело предназначено только для отправки, поэтому reader не определён.
+     */
+    struct SharedBufferBody {
+        using value_type = SharedBuffer;
+
+        static std::uint64_t size(const value_type& body) noexcept {
+            return body ? body->size() : 0;
+        }
+
+        class writer {
+        public:
+            using const_buffers_type = net::const_buffer;
+
+            template <bool isRequest, class Fields>
+            writer(const http::header<isRequest, Fields>&, const value_type& body) noexcept
+                : body_{ body } {
+            }
+
+            void init(beast::error_code& ec) noexcept {
+                ec = {};
+            }
+
+            boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) noexcept {
+                ec = {};
+                if (!body_ || body_->empty()) {
+                    return boost::none;
+                }
+                // Весь буфер отдаётся одним куском, продолжения нет
+                return { { net::const_buffer(body_->data(), body_->size()), false } };
+            }
+
+        private:
+            const value_type& body_;
+        };
+    };
+
+}  // namespace http_server
@@ -1,5 +1,8 @@
 #pragma once
 #include <compare>
+#include <concepts>
+#include <functional>
+#include <string_view>
 
 namespace util {
 
@@ -54,13 +57,42 @@ namespace util {
         Value value_;
     };
 
-    // Хешер для Tagged-типа, чтобы Tagged-объекты можно было хранить в unordered-контейнерах
+    // Хешер для Tagged-типа, чтобы Tagged-объекты можно было хранить в unordered-контейнерах.
+    // Для строковых Tagged-типов он прозрачный: искать можно по std::string_view, не создавая ключ
     template <typename TaggedValue>
     struct TaggedHasher {
+        using is_transparent = void;
+
         size_t operator()(const TaggedValue& value) const {
             // Возвращает хеш значения, хранящегося внутри value
             return std::hash<typename TaggedValue::ValueType>{}(*value);
         }
+
+        // Хеши std::string и std::string_view с одинаковым содержимым по стандарту совпадают
+        size_t operator()(std::string_view value) const
+            requires std::convertible_to<const typename TaggedValue::ValueType&, std::string_view> {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    // Прозрачное сравнение на равенство Tagged-типа с ним самим и с std::string_view
+    template <typename TaggedValue>
+    struct TaggedEqual {
+        using is_transparent = void;
+
+        bool operator()(const TaggedValue& lhs, const TaggedValue& rhs) const {
+            return *lhs == *rhs;
+        }
+
+        bool operator()(const TaggedValue& lhs, std::string_view rhs) const
+            requires std::convertible_to<const typename TaggedValue::ValueType&, std::string_view> {
+            return *lhs == rhs;
+        }
+
+        bool operator()(std::string_view lhs, const TaggedValue& rhs) const
+            requires std::convertible_to<const typename TaggedValue::ValueType&, std::string_view> {
+            return lhs == *rhs;
+        }
     };
 
 }  // namespace util
@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mpsc_queue.h"
+#include "request_metrics.h"
+
+namespace game_tick {
+
+    /*
+     * Движок игры на отдельном потоке с тактом фиксированной длины.
+     * Потоки HTTP не трогают состояние игры: они кладут действия игроков в очередь без блокировок
+     * и читают последний опубликованный снимок. Поток движка в начале такта забирает накопившиеся
+     * действия, применяет их и продвигает игру на period, после чего публикует новый неизменяемый
+     * снимок заменой указателя. Поэтому длинный расчёт такта не задерживает ответы, а медленный
+     * ответ не сдвигает такт.
+     *
+     * Если такт не уложился в period, пропущенные такты не догоняются: следующий начинается
+     * по расписанию, игровое время при перегрузке отстаёт от реального.
+     */
+    template <typename State, typename Action>
+    class TickEngine {
+    public:
+        using Clock = std::chrono::steady_clock;
+        // Применяет действия такта к состоянию и продвигает его на dt
+        using Step = std::function<void(State& state, std::span<Action> actions, Clock::duration dt)>;
+
+        TickEngine(Clock::duration period, std::size_t queue_capacity, State initial, Step step)
+            : period_{ period }
+            , step_{ std::move(step) }
+            , actions_{ queue_capacity }
+            , working_{ std::move(initial) }
+            , snapshot_{ std::make_shared<const State>(working_) } {
+            batch_.reserve(actions_.GetCapacity());
+            thread_ = std::jthread{ [this](std::stop_token stop) {
+                Run(stop);
+                } };
+        }
+
+        TickEngine(const TickEngine&) = delete;
+        TickEngine& operator=(const TickEngine&) = delete;
+
+        // Из любого потока. false - очередь заполнена, действие отброшено
+        bool Submit(Action action) {
+            if (!actions_.TryPush(std::move(action))) {
+                metrics::RecordDroppedAction();
+                return false;
+            }
+            return true;
+        }
+
+        // Из любого потока. Снимок не меняется, пока на него есть ссылка
+        std::shared_ptr<const State> GetSnapshot() const {
+            return snapshot_.load(std::memory_order_acquire);
+        }
+
+    private:
+        void Run(std::stop_token stop) {
+            auto scheduled = Clock::now() + period_;
+            while (WaitUntil(stop, scheduled)) {
+                const auto start = Clock::now();
+
+                metrics::RecordActionQueueDepth(actions_.GetApproxSize());
+                // Не больше вместимости очереди за такт, чтобы постоянный поток действий не растягивал такт
+                batch_.clear();
+                while (batch_.size() < actions_.GetCapacity()) {
+                    auto action = actions_.TryPop();
+                    if (!action) {
+                        break;
+                    }
+                    batch_.push_back(std::move(*action));
+                }
+
+                step_(working_, batch_, period_);
+                snapshot_.store(std::make_shared<const State>(working_), std::memory_order_release);
+
+                const auto finish = Clock::now();
+                metrics::RecordTick(start - scheduled, finish - start, batch_.size());
+
+                scheduled += period_;
+                if (finish >= scheduled) {
+                    const auto skipped = (finish - scheduled) / period_ + 1;
+                    scheduled += skipped * period_;
+                    metrics::RecordSkippedTicks(static_cast<std::uint64_t>(skipped));
+                }
+            }
+        }
+
+        // false - запрошена остановка
+        bool WaitUntil(std::stop_token& stop, Clock::time_point deadline) {
+            std::unique_lock lock{ mutex_ };
+            wakeup_.wait_until(lock, stop, deadline, [] {
+                return false;
+                });
+            return !stop.stop_requested();
+        }
+
+        const Clock::duration period_;
+        const Step step_;
+        BoundedMpscQueue<Action> actions_;
+
+        // Принадлежат потоку движка
+        State working_;
+        std::vector<Action> batch_;
+
+        std::atomic<std::shared_ptr<const State>> snapshot_;
+
+        // Только для ожидания следующего такта с возможностью прерваться при остановке
+        std::mutex mutex_;
+        std::condition_variable_any wakeup_;
+
+        // Последним: при разрушении поток останавливается раньше, чем остальные поля
+        std::jthread thread_;
+    };
+
+}  // namespace game_tick
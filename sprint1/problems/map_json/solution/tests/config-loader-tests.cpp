@@ -0,0 +1,319 @@
+#include <boost/crc.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/game_snapshot.h"
+#include "../src/json_loader.h"
+#include "../src/json_stream_loader.h"
+#include "../src/model.h"
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+    // Файл во временном каталоге, удаляется вместе с объектом
+    class TempFile {
+    public:
+        explicit TempFile(std::string_view content, std::string_view extension = ".json"sv)
+            : path_{ fs::temp_directory_path() / ("game_server_loader_test_"s + std::to_string(next_index_++) + std::string{ extension }) } {
+            std::ofstream out(path_, std::ios::binary);
+            out << content;
+        }
+
+        TempFile(const TempFile&) = delete;
+        TempFile& operator=(const TempFile&) = delete;
+
+        ~TempFile() {
+            std::error_code ec;
+            fs::remove(path_, ec);
+        }
+
+        const fs::path& GetPath() const noexcept {
+            return path_;
+        }
+
+    private:
+        static inline unsigned next_index_ = 0;
+        fs::path path_;
+    };
+
+    // Карта со всеми видами элементов. Неизвестные ключи на каждом уровне - с вложенными объектами,
+    // массивами и значениями всех типов - оба загрузчика должны пропустить
+    std::string MakeMap(int index, int roads, std::string_view name) {
+        const auto i = std::to_string(index);
+        std::string map = R"({"id": "map)"s + i + R"(", "dogSpeed": 1.5, "name": ")"s + std::string{ name } + R"(",)"s;
+        map += R"("lootTypes": [{"name": "key", "scale": 0.03, "nested": {"a": [1, -2.5e3, true, null, "s", []]}}],)"s;
+        map += R"("roads": [)"s;
+        for (int r = 0; r < roads; ++r) {
+            const auto c = std::to_string(r * 10 - 500);
+            map += r % 2 == 0
+                ? R"({"x0": )"s + c + R"(, "y0": )"s + i + R"(, "x1": )"s + std::to_string(r * 10 - 450) + "},"s
+                : R"({"comment": {"x1": 1}, "x0": )"s + i + R"(, "y0": )"s + c + R"(, "y1": )"s + c + "},"s;
+        }
+        // Дорога без x1 и y1 пропускается обоими загрузчиками
+        map += R"({"x0": 7, "y0": 7}],)"s;
+        map += R"("buildings": [{"x": 5, "y": -5, "w": 30, "h": 20, "color": "red"}, {"h": 0, "w": 0, "y": 1, "x": 1}],)"s;
+        map += R"("offices": [{"id": "o)"s + i + R"(", "x": 40, "y": 30, "offsetX": 5, "offsetY": -1}, )"s;
+        map += R"({"offsetY": 0, "offsetX": 0, "y": 0, "x": 0, "id": "second"}]})"s;
+        return map;
+    }
+
+    std::string MakeConfig(std::string_view padding, const std::vector<std::string>& maps) {
+        std::string config{ padding };
+        config += R"({"defaultDogSpeed": 3.0, "maps": [)"s;
+        for (size_t i = 0; i < maps.size(); ++i) {
+            config += i == 0 ? ""s : ","s;
+            config += maps[i];
+        }
+        config += R"(], "tail": {"maps": []}})"s;
+        return config;
+    }
+
+    void CheckSamePoint(model::Point lhs, model::Point rhs) {
+        CHECK(lhs.x == rhs.x);
+        CHECK(lhs.y == rhs.y);
+    }
+
+    // Поэлементное сравнение результатов двух загрузчиков, включая порядок карт и элементов
+    void CheckSameGames(const model::Game& expected, const model::Game& actual) {
+        REQUIRE(expected.GetMaps().size() == actual.GetMaps().size());
+        for (size_t m = 0; m < expected.GetMaps().size(); ++m) {
+            const auto& lhs = expected.GetMaps()[m];
+            const auto& rhs = actual.GetMaps()[m];
+            INFO("map " << *lhs.GetId());
+            CHECK(*lhs.GetId() == *rhs.GetId());
+            CHECK(lhs.GetName() == rhs.GetName());
+            CHECK(lhs.IsIndexed());
+            CHECK(rhs.IsIndexed());
+            CHECK(actual.FindMap(lhs.GetId()) == &rhs);
+
+            REQUIRE(lhs.GetRoads().size() == rhs.GetRoads().size());
+            for (size_t i = 0; i < lhs.GetRoads().size(); ++i) {
+                CheckSamePoint(lhs.GetRoads()[i].GetStart(), rhs.GetRoads()[i].GetStart());
+                CheckSamePoint(lhs.GetRoads()[i].GetEnd(), rhs.GetRoads()[i].GetEnd());
+            }
+
+            REQUIRE(lhs.GetBuildings().size() == rhs.GetBuildings().size());
+            for (size_t i = 0; i < lhs.GetBuildings().size(); ++i) {
+                const auto& lhs_bounds = lhs.GetBuildings()[i].GetBounds();
+                const auto& rhs_bounds = rhs.GetBuildings()[i].GetBounds();
+                CheckSamePoint(lhs_bounds.position, rhs_bounds.position);
+                CHECK(lhs_bounds.size.width == rhs_bounds.size.width);
+                CHECK(lhs_bounds.size.height == rhs_bounds.size.height);
+            }
+
+            REQUIRE(lhs.GetOffices().size() == rhs.GetOffices().size());
+            for (size_t i = 0; i < lhs.GetOffices().size(); ++i) {
+                const auto& lhs_office = lhs.GetOffices()[i];
+                const auto& rhs_office = rhs.GetOffices()[i];
+                CHECK(*lhs_office.GetId() == *rhs_office.GetId());
+                CheckSamePoint(lhs_office.GetPosition(), rhs_office.GetPosition());
+                CHECK(lhs_office.GetOffset().dx == rhs_office.GetOffset().dx);
+                CHECK(lhs_office.GetOffset().dy == rhs_office.GetOffset().dy);
+                CHECK(rhs.FindOffice(*lhs_office.GetId()) == &rhs_office);
+            }
+        }
+    }
+
+    void CheckBothLoadSame(std::string_view content) {
+        const TempFile config{ content };
+        const auto dom = json_loader::LoadGame{}(config.GetPath());
+        const auto stream = json_loader::StreamLoadGame{}(config.GetPath());
+        CheckSameGames(dom, stream);
+    }
+
+    void CheckBothReject(std::string_view content) {
+        INFO(content);
+        const TempFile config{ content };
+        CHECK_THROWS(json_loader::LoadGame{}(config.GetPath()));
+        CHECK_THROWS(json_loader::StreamLoadGame{}(config.GetPath()));
+    }
+
+    std::string ReadFile(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+    }
+
+    // Смещения полей в заголовке снимка (см. Header в game_snapshot.cpp) и размер заголовка
+    constexpr size_t VERSION_OFFSET = 8;
+    constexpr size_t ROAD_COUNT_OFFSET = 20;
+    constexpr size_t CHECKSUM_OFFSET = 36;
+    constexpr size_t HEADER_SIZE = 40;
+    // Смещение road_count в первой записи карты: после id, name и first_road
+    constexpr size_t FIRST_MAP_ROAD_COUNT_OFFSET = HEADER_SIZE + 20;
+
+    void PutUint32(std::string& data, size_t offset, std::uint32_t value) {
+        std::memcpy(data.data() + offset, &value, sizeof(value));
+    }
+
+    // Пересчитывает контрольную сумму, чтобы испорченное поле дошло до проверок за ней
+    void UpdateChecksum(std::string& data) {
+        boost::crc_32_type crc;
+        crc.process_bytes(data.data() + HEADER_SIZE, data.size() - HEADER_SIZE);
+        PutUint32(data, CHECKSUM_OFFSET, crc.checksum());
+    }
+
+    void CheckSnapshotRejected(std::string_view data) {
+        const TempFile snapshot{ data, ".snapshot"sv };
+        CHECK_THROWS_AS(game_snapshot::LoadSnapshot(snapshot.GetPath()), std::invalid_argument);
+    }
+
+}  // namespace
+
+SCENARIO("DOM and stream config loaders") {
+    GIVEN("a small config") {
+        const auto content = MakeConfig(""sv, { MakeMap(1, 4, "Map 1"sv), MakeMap(2, 0, "Map 2"sv) });
+
+        THEN("both loaders build the same game") {
+            const TempFile config{ content };
+            const auto dom = json_loader::LoadGame{}(config.GetPath());
+            const auto stream = json_loader::StreamLoadGame{}(config.GetPath());
+            CheckSameGames(dom, stream);
+
+            REQUIRE(stream.GetMaps().size() == 2);
+            const auto& map = stream.GetMaps().front();
+            CHECK(map.GetRoads().size() == 4);
+            CHECK(map.GetBuildings().size() == 2);
+            CHECK(map.GetOffices().size() == 2);
+            CHECK(map.GetOffices().front().GetOffset().dy == -1);
+        }
+    }
+
+    GIVEN("configs larger than the read chunk of the stream loader") {
+        // Длинные ключ и строка гарантированно разрезаются границей блока, а сдвиг всего файла
+        // на несколько байт переносит эту границу внутрь разных чисел и ключей
+        const std::string long_name(json_loader::StreamLoadGame::CHUNK_SIZE + 100, 'n');
+        const std::string long_key = "\""s + std::string(json_loader::StreamLoadGame::CHUNK_SIZE, 'k') + "\": 1, "s;
+
+        THEN("both loaders build the same game for every shift of the chunk boundary") {
+            for (const size_t shift : { 0, 1, 2, 3, 5, 8, 13 }) {
+                INFO("shift " << shift);
+                std::vector<std::string> maps;
+                for (int i = 0; i < 40; ++i) {
+                    maps.push_back(MakeMap(i, 50, i == 7 ? std::string_view{ long_name } : "name"sv));
+                }
+                auto content = MakeConfig(std::string(shift, ' '), maps);
+                content.insert(content.find("\"maps\""sv), long_key);
+                REQUIRE(content.size() > 3 * json_loader::StreamLoadGame::CHUNK_SIZE);
+                CheckBothLoadSame(content);
+            }
+        }
+    }
+
+    GIVEN("malformed configs") {
+        const auto valid_map = MakeMap(1, 2, "Map"sv);
+
+        THEN("both loaders reject broken JSON") {
+            const auto content = MakeConfig(""sv, { valid_map });
+            CheckBothReject(content.substr(0, content.size() / 2));
+            CheckBothReject(content + "}"s);
+            CheckBothReject(""sv);
+        }
+
+        THEN("both loaders reject a config without maps") {
+            CheckBothReject(R"({})"sv);
+            CheckBothReject(R"({"tail": {"maps": []}})"sv);
+            CheckBothReject(R"([])"sv);
+            CheckBothReject(R"({"maps": {}})"sv);
+            CheckBothReject(R"({"maps": [1]})"sv);
+        }
+
+        THEN("both loaders reject values of a wrong type") {
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "roads": [{"x0": 1.5, "y0": 0, "x1": 3}], "buildings": [], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "roads": [{"x0": "1", "y0": 0, "x1": 3}], "buildings": [], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "roads": [], "buildings": [{"x": 0, "y": true, "w": 1, "h": 1}], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "roads": [], "buildings": [], "offices": [{"id": 5, "x": 0, "y": 0, "offsetX": 0, "offsetY": 0}]}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": 1, "name": "n", "roads": [], "buildings": [], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": null, "roads": [], "buildings": [], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "roads": {}, "buildings": [], "offices": []}]})"sv);
+        }
+
+        THEN("both loaders reject missing required fields") {
+            CheckBothReject(R"({"maps": [{"id": "m", "roads": [], "buildings": [], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "buildings": [], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "roads": [{"x0": 1, "x1": 3}], "buildings": [], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "roads": [], "buildings": [{"x": 0, "y": 0, "w": 1}], "offices": []}]})"sv);
+            CheckBothReject(R"({"maps": [{"id": "m", "name": "n", "roads": [], "buildings": [], "offices": [{"id": "o", "x": 0, "y": 0, "offsetX": 0}]}]})"sv);
+        }
+
+        THEN("both loaders reject duplicate map ids") {
+            CheckBothReject(MakeConfig(""sv, { valid_map, valid_map }));
+        }
+    }
+
+    GIVEN("a missing file") {
+        THEN("both loaders throw") {
+            const auto path = fs::temp_directory_path() / "game_server_loader_test_missing.json"sv;
+            CHECK_THROWS_AS(json_loader::LoadGame{}(path), std::invalid_argument);
+            CHECK_THROWS_AS(json_loader::StreamLoadGame{}(path), std::invalid_argument);
+        }
+    }
+}
+
+SCENARIO("Game snapshot") {
+    GIVEN("a game loaded from JSON and written to a snapshot") {
+        const auto content = MakeConfig(""sv, { MakeMap(1, 6, "Map 1"sv), MakeMap(2, 0, "Map 2"sv), MakeMap(3, 3, "Map 3"sv) });
+        const TempFile config{ content };
+        const auto game = json_loader::LoadGame{}(config.GetPath());
+        const TempFile snapshot{ ""sv, ".snapshot"sv };
+        game_snapshot::WriteSnapshot(game, snapshot.GetPath());
+        const auto data = ReadFile(snapshot.GetPath());
+        REQUIRE(data.size() > HEADER_SIZE);
+
+        THEN("only the snapshot is recognized as one") {
+            CHECK(game_snapshot::IsSnapshot(snapshot.GetPath()));
+            CHECK_FALSE(game_snapshot::IsSnapshot(config.GetPath()));
+        }
+
+        THEN("loading it gives the same game as loading the JSON") {
+            CheckSameGames(game, game_snapshot::LoadSnapshot(snapshot.GetPath()));
+        }
+
+        THEN("a flipped byte is caught by the checksum") {
+            for (const size_t offset : { HEADER_SIZE, data.size() / 2, data.size() - 1 }) {
+                auto corrupted = data;
+                corrupted[offset] ^= 0x10;
+                CheckSnapshotRejected(corrupted);
+            }
+        }
+
+        THEN("a truncated snapshot is rejected") {
+            CheckSnapshotRejected(data.substr(0, data.size() - 1));
+            CheckSnapshotRejected(data.substr(0, HEADER_SIZE));
+            CheckSnapshotRejected(data.substr(0, HEADER_SIZE - 1));
+            CheckSnapshotRejected(""sv);
+        }
+
+        THEN("a snapshot of another version is rejected") {
+            auto other_version = data;
+            PutUint32(other_version, VERSION_OFFSET, 2);
+            CheckSnapshotRejected(other_version);
+        }
+
+        THEN("counts past the end of the file are rejected even with a valid checksum") {
+            auto too_many_roads = data;
+            PutUint32(too_many_roads, ROAD_COUNT_OFFSET, 0xFFFF'FFFF);
+            CheckSnapshotRejected(too_many_roads);
+
+            auto map_slice_past_end = data;
+            PutUint32(map_slice_past_end, FIRST_MAP_ROAD_COUNT_OFFSET, 0xFFFF'FFFF);
+            UpdateChecksum(map_slice_past_end);
+            CheckSnapshotRejected(map_slice_past_end);
+
+            auto trailing_data = data + "x"s;
+            UpdateChecksum(trailing_data);
+            CheckSnapshotRejected(trailing_data);
+        }
+    }
+}
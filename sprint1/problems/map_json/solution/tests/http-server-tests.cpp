@@ -0,0 +1,272 @@
+#include "../src/sdk.h"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/write.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../src/http_server.h"
+#include "../src/json_serializer.h"
+#include "../src/model.h"
+#include "../src/request_handler.h"
+#include "../src/response_cache.h"
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+
+namespace {
+
+    // Сервер на свободном порту loopback. Соединения обслуживаются в отдельном потоке
+    class TestServer {
+    public:
+        template <typename Handler>
+        explicit TestServer(Handler&& handler)
+            : endpoint_{ http_server::ServeHttp(ioc_, { net::ip::make_address("127.0.0.1"), 0 }, std::forward<Handler>(handler)) }
+            , thread_{ [this] {
+                ioc_.run();
+                } } {
+        }
+
+        ~TestServer() {
+            ioc_.stop();
+        }
+
+        const tcp::endpoint& GetEndpoint() const noexcept {
+            return endpoint_;
+        }
+
+    private:
+        net::io_context ioc_;
+        tcp::endpoint endpoint_;
+        std::jthread thread_;
+    };
+
+    struct TestRequest {
+        http::verb method;
+        std::string_view target;
+        std::string_view body = {};
+    };
+
+    using TestResponse = http::response<http::string_body>;
+
+    // Ответ, не пришедший за это время, считается потерянным
+    constexpr auto RESPONSE_TIMEOUT = 5s;
+
+    // Отправляет все запросы одной записью и читает ответы по порядку, пока сервер их присылает
+    std::vector<TestResponse> SendPipelined(const tcp::endpoint& endpoint, const std::vector<TestRequest>& requests) {
+        net::io_context ioc;
+        tcp::socket socket{ ioc };
+        socket.connect(endpoint);
+
+        std::string out;
+        for (const auto& request : requests) {
+            out += http::to_string(request.method);
+            out += ' ';
+            out += request.target;
+            out += " HTTP/1.1\r\nHost: localhost\r\n"sv;
+            if (!request.body.empty()) {
+                out += "Content-Type: application/json\r\nContent-Length: "sv;
+                out += std::to_string(request.body.size());
+                out += "\r\n"sv;
+            }
+            out += "\r\n"sv;
+            out += request.body;
+        }
+        net::write(socket, net::buffer(out));
+
+        std::vector<TestResponse> responses;
+        beast::flat_buffer buffer;
+        for (const auto& request : requests) {
+            http::response_parser<http::string_body> parser;
+            // У ответа на HEAD есть Content-Length, но нет тела
+            parser.skip(request.method == http::verb::head);
+            std::optional<beast::error_code> result;
+            http::async_read(socket, buffer, parser, [&result](beast::error_code ec, std::size_t) {
+                result = ec;
+                });
+            ioc.restart();
+            ioc.run_for(RESPONSE_TIMEOUT);
+            if (!result) {
+                // Дожидаемся отмены чтения, пока parser ещё жив
+                socket.close();
+                ioc.restart();
+                ioc.run();
+            }
+            if (!result || *result) {
+                break;
+            }
+            responses.push_back(parser.release());
+        }
+        return responses;
+    }
+
+    // Отвечает только на GET, возвращая в теле цель запроса - как обработчик, забывший про другие методы
+    struct GetOnlyHandler {
+        template <typename Body, typename Allocator, typename Send>
+        void operator()(http::request<Body, http::basic_fields<Allocator>>&& request, Send&& send) const {
+            if (request.method() != http::verb::get) {
+                return;
+            }
+            http::response<http::string_body, http::basic_fields<Allocator>> response(
+                std::piecewise_construct, std::make_tuple(std::string{ request.target() }), std::make_tuple(request.get_allocator()));
+            response.result(http::status::ok);
+            response.version(request.version());
+            response.keep_alive(request.keep_alive());
+            response.prepare_payload();
+            send(std::move(response));
+        }
+    };
+
+    using HandlerResponse = http_handler::SharedHttpResponse<std::allocator<char>>;
+
+    // Передаёт обработчику GET-запрос напрямую, без сервера, и возвращает его ответ
+    HandlerResponse HandleGet(http_handler::RequestHandler& handler, std::string_view target, std::string_view if_none_match = {}) {
+        http::request<http::string_body> request{ http::verb::get, target, 11 };
+        if (!if_none_match.empty()) {
+            request.set(http::field::if_none_match, if_none_match);
+        }
+        std::optional<HandlerResponse> response;
+        handler(std::move(request), [&response](auto&& sent) {
+            response.emplace(std::forward<decltype(sent)>(sent));
+            });
+        REQUIRE(response);
+        return std::move(*response);
+    }
+
+    model::Game MakeGame() {
+        model::Map map{ model::Map::Id{ "map1"s }, "Map 1"s };
+        map.AddRoad({ model::Road::HORIZONTAL, { 0, 0 }, 40 });
+        map.AddOffice({ model::Office::Id{ "o0"s }, { 40, 0 }, { 5, 0 } });
+        model::Game game;
+        game.AddMap(std::move(map));
+        return game;
+    }
+
+}  // namespace
+
+SCENARIO("Pipelined requests") {
+    GIVEN("a handler that answers only GET") {
+        TestServer server{ GetOnlyHandler{} };
+
+        WHEN("GET, POST and GET are pipelined") {
+            const auto responses = SendPipelined(server.GetEndpoint(), {
+                { http::verb::get, "/first"sv },
+                { http::verb::post, "/second"sv, "{}"sv },
+                { http::verb::get, "/third"sv },
+                });
+
+            THEN("the session answers the unanswered request itself and keeps the order") {
+                REQUIRE(responses.size() == 3);
+                CHECK(responses[0].result() == http::status::ok);
+                CHECK(responses[0].body() == "/first"sv);
+                CHECK(responses[1].result() == http::status::internal_server_error);
+                CHECK(responses[1].body().empty());
+                CHECK(responses[2].result() == http::status::ok);
+                CHECK(responses[2].body() == "/third"sv);
+            }
+        }
+    }
+
+    GIVEN("the game request handler") {
+        model::Game game = MakeGame();
+        http_handler::RequestHandler handler{ game };
+        TestServer server{ [&handler](auto&& request, auto&& send) {
+            handler(std::forward<decltype(request)>(request), std::forward<decltype(send)>(send));
+            } };
+
+        WHEN("requests with different methods are pipelined") {
+            const auto responses = SendPipelined(server.GetEndpoint(), {
+                { http::verb::get, "/api/v1/maps"sv },
+                { http::verb::post, "/api/v1/maps"sv, "{\"id\":\"map2\"}"sv },
+                { http::verb::head, "/api/v1/maps/map1"sv },
+                { http::verb::delete_, "/api/v1/maps/map1"sv },
+                { http::verb::get, "/api/v1/maps/map1"sv },
+                });
+
+            THEN("every request gets exactly one response, in order") {
+                REQUIRE(responses.size() == 5);
+
+                CHECK(responses[0].result() == http::status::ok);
+                CHECK(responses[0].body().find("\"map1\""sv) != std::string::npos);
+
+                for (const auto* rejected : { &responses[1], &responses[3] }) {
+                    CHECK(rejected->result() == http::status::method_not_allowed);
+                    CHECK((*rejected)[http::field::allow] == http_handler::ALLOWED_METHODS);
+                    CHECK(rejected->body().find("invalidMethod"sv) != std::string::npos);
+                }
+
+                const auto& head = responses[2];
+                const auto& get = responses[4];
+                CHECK(head.result() == http::status::ok);
+                CHECK(head.body().empty());
+                CHECK(get.result() == http::status::ok);
+                CHECK(get.body().find("\"offices\""sv) != std::string::npos);
+                CHECK(head[http::field::content_length] == std::to_string(get.body().size()));
+                CHECK(head[http::field::etag] == get[http::field::etag]);
+            }
+        }
+    }
+}
+
+SCENARIO("Cached map responses") {
+    GIVEN("the game request handler") {
+        model::Game game = MakeGame();
+        http_handler::RequestHandler handler{ game };
+
+        WHEN("the list of maps is requested") {
+            const auto response = HandleGet(handler, "/api/v1/maps"sv);
+
+            THEN("the body is the same as a fresh serialization") {
+                const auto expected = boost::json::serialize(json_serializer::SerializeAllMaps(game.GetMaps()));
+                CHECK(response.result() == http::status::ok);
+                REQUIRE(response.body());
+                CHECK(*response.body() == expected);
+                CHECK(response[http::field::etag] == response_cache::MakeETag(expected));
+            }
+        }
+
+        WHEN("a map is requested") {
+            const auto response = HandleGet(handler, "/api/v1/maps/map1"sv);
+            const auto expected = boost::json::serialize(json_serializer::SerializeCurrentMap(game.GetMaps().front()));
+
+            THEN("the body, its length and the ETag match a fresh serialization") {
+                CHECK(response.result() == http::status::ok);
+                REQUIRE(response.body());
+                CHECK(*response.body() == expected);
+                CHECK(response[http::field::content_length] == std::to_string(expected.size()));
+                CHECK(response[http::field::etag] == response_cache::MakeETag(expected));
+            }
+
+            AND_WHEN("it is requested again with the ETag in If-None-Match") {
+                const std::string etag{ response[http::field::etag] };
+                const auto not_modified = HandleGet(handler, "/api/v1/maps/map1"sv, etag);
+
+                THEN("the answer is 304 with the same ETag and no body") {
+                    CHECK(not_modified.result() == http::status::not_modified);
+                    CHECK(not_modified[http::field::etag] == etag);
+                    CHECK_FALSE(not_modified.body());
+                }
+            }
+
+            AND_WHEN("it is requested with a stale ETag") {
+                const auto fresh = HandleGet(handler, "/api/v1/maps/map1"sv, "\"0000000000000000\""sv);
+
+                THEN("the full body is sent") {
+                    CHECK(fresh.result() == http::status::ok);
+                    REQUIRE(fresh.body());
+                    CHECK(*fresh.body() == expected);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,246 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "../src/model.h"
+
+using model::Coord;
+using model::Point;
+using model::Road;
+
+namespace {
+
+    std::int64_t SquaredDistance(Point lhs, Point rhs) {
+        const std::int64_t dx = static_cast<std::int64_t>(lhs.x) - rhs.x;
+        const std::int64_t dy = static_cast<std::int64_t>(lhs.y) - rhs.y;
+        return dx * dx + dy * dy;
+    }
+
+    // Ближайшая к point точка отрезка дороги
+    Point ClosestOnRoad(const Road& road, Point point) {
+        const auto start = road.GetStart();
+        const auto end = road.GetEnd();
+        return { std::clamp(point.x, std::min(start.x, end.x), std::max(start.x, end.x)),
+                 std::clamp(point.y, std::min(start.y, end.y), std::max(start.y, end.y)) };
+    }
+
+    bool IsOnRoad(const Road& road, Point point) {
+        return SquaredDistance(ClosestOnRoad(road, point), point) == 0;
+    }
+
+    // Сверяет индекс с линейным перебором всех дорог
+    void CheckRoadIndex(const std::vector<Road>& roads, const model::RoadIndex& index, Point point) {
+        INFO("point " << point.x << ", " << point.y);
+
+        const bool on_any_road = std::any_of(roads.begin(), roads.end(), [point](const Road& road) {
+            return IsOnRoad(road, point);
+            });
+        const auto road_at = index.FindRoadAt(point);
+        REQUIRE(road_at.has_value() == on_any_road);
+        if (road_at) {
+            REQUIRE(*road_at < roads.size());
+            CHECK(IsOnRoad(roads[*road_at], point));
+        }
+
+        std::optional<std::int64_t> best;
+        for (const auto& road : roads) {
+            const auto distance = SquaredDistance(ClosestOnRoad(road, point), point);
+            best = best ? std::min(*best, distance) : distance;
+        }
+        const auto nearest = index.FindNearestRoad(point);
+        REQUIRE(nearest.has_value() == best.has_value());
+        if (nearest) {
+            REQUIRE(nearest->road < roads.size());
+            // Ближайших дорог может быть несколько - проверяем, что выбранная одна из них
+            // и что ближайшая точка лежит на ней
+            CHECK(SquaredDistance(nearest->closest, point) == *best);
+            CHECK(IsOnRoad(roads[nearest->road], nearest->closest));
+            const double distance = std::sqrt(static_cast<double>(*best));
+            CHECK(std::abs(nearest->distance - distance) <= 1e-9 * (1 + distance));
+        }
+    }
+
+    Road MakeRoad(bool horizontal, Point start, Coord end) {
+        return horizontal ? Road{ Road::HORIZONTAL, start, end } : Road{ Road::VERTICAL, start, end };
+    }
+
+    using Box = model::SpatialGrid::Box;
+
+    std::int64_t SquaredDistance(const Box& box, Point point) {
+        return SquaredDistance(Point{ std::clamp(point.x, box.min_x, box.max_x), std::clamp(point.y, box.min_y, box.max_y) }, point);
+    }
+
+    // Сверяет сетку с перебором всех прямоугольников
+    void CheckGridIntersecting(const std::vector<Box>& boxes, const model::SpatialGrid& grid, const Box& area) {
+        INFO("area " << area.min_x << ", " << area.min_y << " - " << area.max_x << ", " << area.max_y);
+        std::vector<size_t> expected;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            const auto& box = boxes[i];
+            if (box.max_x >= area.min_x && box.min_x <= area.max_x && box.max_y >= area.min_y && box.min_y <= area.max_y) {
+                expected.push_back(i);
+            }
+        }
+        std::vector<size_t> found;
+        grid.FindIntersecting(area, found);
+        // Порядок не задан, но каждый элемент должен встретиться один раз
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+    }
+
+    void CheckGridNearest(const std::vector<Box>& boxes, const model::SpatialGrid& grid, Point point) {
+        INFO("point " << point.x << ", " << point.y);
+        // При равных расстояниях сетка выбирает элемент с меньшим номером
+        std::optional<size_t> expected;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            if (!expected || SquaredDistance(boxes[i], point) < SquaredDistance(boxes[*expected], point)) {
+                expected = i;
+            }
+        }
+        const auto found = grid.FindNearest(point);
+        REQUIRE(found.has_value() == expected.has_value());
+        if (found) {
+            CHECK(SquaredDistance(boxes[*found], point) == SquaredDistance(boxes[*expected], point));
+            CHECK(*found == *expected);
+        }
+    }
+
+}  // namespace
+
+SCENARIO("Road index") {
+    GIVEN("an empty map") {
+        const model::RoadIndex index{ std::vector<Road>{} };
+
+        THEN("nothing is found") {
+            CHECK_FALSE(index.FindRoadAt({ 0, 0 }));
+            CHECK_FALSE(index.FindNearestRoad({ 0, 0 }));
+        }
+    }
+
+    GIVEN("overlapping collinear and zero-length roads") {
+        const std::vector<Road> roads{
+            Road{ Road::HORIZONTAL, { 0, 0 }, 10 },
+            Road{ Road::HORIZONTAL, { 15, 0 }, 5 },     // задом наперёд и внахлёст с первой
+            Road{ Road::HORIZONTAL, { 2, 0 }, 3 },      // целиком внутри первой
+            Road{ Road::HORIZONTAL, { 30, 0 }, 30 },    // нулевой длины
+            Road{ Road::VERTICAL, { 30, 0 }, 30 },      // нулевой длины в той же точке
+            Road{ Road::VERTICAL, { 10, -5 }, 5 },
+            Road{ Road::VERTICAL, { 10, 20 }, 0 },
+        };
+        const model::RoadIndex index{ roads };
+
+        THEN("it agrees with a linear scan") {
+            // Концы дорог, точки рядом с ними, между дорогами и далеко от всех дорог
+            for (const Point point : std::vector<Point>{
+                { 0, 0 }, { 10, 0 }, { 15, 0 }, { 16, 0 }, { 5, 0 }, { -1, 0 }, { 30, 0 }, { 29, 0 }, { 30, 1 },
+                { 22, 0 }, { 23, 0 }, { 10, -5 }, { 10, 20 }, { 10, 21 }, { 11, 7 }, { 20, 20 },
+                { 1'000'000, -1'000'000 }, { -1'000'000'000, 1'000'000'000 } }) {
+                CheckRoadIndex(roads, index, point);
+            }
+        }
+    }
+
+    GIVEN("random maps") {
+        std::mt19937 random{ 13 };
+        const auto coord = [&random](Coord min, Coord max) {
+            return std::uniform_int_distribution<Coord>{ min, max }(random);
+        };
+
+        THEN("it agrees with a linear scan") {
+            for (int map = 0; map < 200; ++map) {
+                // Маленькое поле, чтобы дороги часто пересекались, накладывались и совпадали концами
+                const Coord field = coord(3, 40);
+                std::vector<Road> roads(static_cast<size_t>(coord(0, 30)), Road{ Road::HORIZONTAL, { 0, 0 }, 0 });
+                for (auto& road : roads) {
+                    const Point start{ coord(-field, field), coord(-field, field) };
+                    const Coord length = coord(0, 3) == 0 ? 0 : coord(-field, field);
+                    const bool horizontal = coord(0, 1) == 0;
+                    road = MakeRoad(horizontal, start, (horizontal ? start.x : start.y) + length);
+                }
+                const model::RoadIndex index{ roads };
+
+                for (int query = 0; query < 100; ++query) {
+                    CheckRoadIndex(roads, index, { coord(-field - 5, field + 5), coord(-field - 5, field + 5) });
+                }
+                for (const auto& road : roads) {
+                    CheckRoadIndex(roads, index, road.GetStart());
+                    CheckRoadIndex(roads, index, road.GetEnd());
+                }
+                CheckRoadIndex(roads, index, { coord(-1'000'000, 1'000'000), 1'000'000 });
+            }
+        }
+    }
+}
+
+SCENARIO("Spatial grid") {
+    GIVEN("an empty grid") {
+        const model::SpatialGrid grid{ std::vector<Box>{} };
+
+        THEN("nothing is found") {
+            std::vector<size_t> found;
+            grid.FindIntersecting({ -100, -100, 100, 100 }, found);
+            CHECK(found.empty());
+            CHECK_FALSE(grid.FindNearest({ 0, 0 }));
+        }
+    }
+
+    GIVEN("small boxes, points and one box spanning many cells") {
+        const std::vector<Box> boxes{
+            { 0, 0, 2, 2 }, { 5, 5, 5, 5 }, { 10, 0, 12, 1 }, { 3, 8, 4, 9 }, { 20, 20, 20, 20 },
+            { 17, 3, 19, 4 }, { 6, 14, 6, 14 }, { -1, 0, 20, 19 }, { 8, 8, 8, 8 }, { 8, 8, 8, 8 },
+        };
+        const model::SpatialGrid grid{ boxes };
+
+        THEN("intersections agree with brute force, including touching borders") {
+            for (const Box& area : std::vector<Box>{
+                { 2, 2, 2, 2 }, { 3, 3, 4, 4 }, { 5, 5, 5, 5 }, { 12, 1, 17, 3 }, { 21, 21, 30, 30 },
+                { 20, 20, 20, 20 }, { -100, -100, 100, 100 }, { -100, -100, -2, -1 }, { 8, 8, 8, 8 },
+                { 1'000'000, 1'000'000, 1'000'001, 1'000'001 } }) {
+                CheckGridIntersecting(boxes, grid, area);
+            }
+        }
+
+        THEN("nearest boxes agree with brute force, also outside the grid") {
+            for (const Point point : std::vector<Point>{
+                { 0, 0 }, { 8, 8 }, { 21, 21 }, { -5, -5 }, { 25, 10 }, { 10, -30 },
+                { 1'000'000'000, 1'000'000'000 }, { -1'000'000'000, 5 }, { 5, 2'000'000'000 } }) {
+                CheckGridNearest(boxes, grid, point);
+            }
+        }
+    }
+
+    GIVEN("random sets of boxes") {
+        std::mt19937 random{ 14 };
+        const auto coord = [&random](Coord min, Coord max) {
+            return std::uniform_int_distribution<Coord>{ min, max }(random);
+        };
+        const auto random_box = [&coord](Coord field, Coord max_size) {
+            const Coord x = coord(-field, field);
+            const Coord y = coord(-field, field);
+            return Box{ x, y, x + coord(0, max_size), y + coord(0, max_size) };
+        };
+
+        THEN("queries agree with brute force") {
+            for (int set = 0; set < 200; ++set) {
+                const Coord field = coord(1, 200);
+                std::vector<Box> boxes(static_cast<size_t>(coord(1, 60)));
+                for (auto& box : boxes) {
+                    // Офисы - точки, здания - прямоугольники, изредка - во много ячеек
+                    const int kind = coord(0, 9);
+                    box = random_box(field, kind < 3 ? 0 : kind < 9 ? field / 10 : field);
+                }
+                const model::SpatialGrid grid{ boxes };
+
+                for (int query = 0; query < 50; ++query) {
+                    CheckGridIntersecting(boxes, grid, random_box(field * 2, field / 2));
+                    CheckGridNearest(boxes, grid, { coord(-field * 2, field * 2), coord(-field * 2, field * 2) });
+                }
+                CheckGridNearest(boxes, grid, { coord(-1'000'000'000, 1'000'000'000), -1'000'000'000 });
+            }
+        }
+    }
+}
@@ -0,0 +1,197 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/mpsc_queue.h"
+#include "../src/request_metrics.h"
+#include "../src/tick_engine.h"
+
+using namespace std::literals;
+
+namespace {
+
+    // Снимок, не изменившийся за это время, считается зависшим
+    constexpr auto WAIT_TIMEOUT = 5s;
+
+    // Ждёт, пока pred не станет истинным, но не дольше WAIT_TIMEOUT
+    template <typename Pred>
+    bool WaitFor(Pred pred) {
+        const auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+        while (!pred()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    struct Counter {
+        std::uint64_t tick = 0;
+        std::uint64_t sum = 0;
+        std::size_t actions = 0;
+    };
+
+    using CounterEngine = game_tick::TickEngine<Counter, std::uint64_t>;
+
+    void StepCounter(Counter& counter, std::span<std::uint64_t> actions, CounterEngine::Clock::duration) {
+        for (const auto value : actions) {
+            counter.sum += value;
+        }
+        counter.actions += actions.size();
+        ++counter.tick;
+    }
+
+}  // namespace
+
+SCENARIO("Bounded MPSC queue") {
+    GIVEN("a queue with a capacity that is not a power of two") {
+        game_tick::BoundedMpscQueue<int> queue{ 5 };
+
+        THEN("the capacity is rounded up") {
+            CHECK(queue.GetCapacity() == 8);
+            CHECK(game_tick::BoundedMpscQueue<int>{ 0 }.GetCapacity() == 2);
+        }
+
+        WHEN("it is filled up") {
+            for (int i = 0; i < 8; ++i) {
+                REQUIRE(queue.TryPush(int{ i }));
+            }
+
+            THEN("the next push is rejected until an item is popped") {
+                CHECK(queue.GetApproxSize() == 8);
+                CHECK_FALSE(queue.TryPush(8));
+                CHECK(queue.TryPop() == 0);
+                CHECK(queue.TryPush(8));
+                CHECK_FALSE(queue.TryPush(9));
+            }
+
+            THEN("items are popped in order") {
+                for (int i = 0; i < 8; ++i) {
+                    CHECK(queue.TryPop() == i);
+                }
+                CHECK_FALSE(queue.TryPop());
+                CHECK(queue.GetApproxSize() == 0);
+            }
+        }
+    }
+
+    GIVEN("several producers and a small queue") {
+        constexpr std::uint64_t PRODUCERS = 4;
+        constexpr std::uint64_t ITEMS_PER_PRODUCER = 100'000;
+        // Маленькая очередь, чтобы писатели часто упирались в заполненный буфер и шли на новый круг
+        game_tick::BoundedMpscQueue<std::uint64_t> queue{ 64 };
+        std::atomic<std::uint64_t> rejected{ 0 };
+
+        WHEN("every producer pushes its own numbered items") {
+            std::vector<std::uint64_t> next(PRODUCERS, 0);
+            std::uint64_t received = 0;
+            bool in_order = true;
+            {
+                std::vector<std::jthread> producers;
+                for (std::uint64_t producer = 0; producer < PRODUCERS; ++producer) {
+                    producers.emplace_back([&queue, &rejected, producer] {
+                        for (std::uint64_t i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+                            // Старшие биты - номер писателя, младшие - номер элемента
+                            while (!queue.TryPush((producer << 32) | i)) {
+                                rejected.fetch_add(1, std::memory_order_relaxed);
+                                std::this_thread::yield();
+                            }
+                        }
+                        });
+                }
+
+                while (received < PRODUCERS * ITEMS_PER_PRODUCER) {
+                    const auto item = queue.TryPop();
+                    if (!item) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    const auto producer = *item >> 32;
+                    const auto index = *item & 0xFFFF'FFFF;
+                    // Потерянный элемент даст пропуск номера, повторный - номер меньше ожидаемого
+                    if (producer >= PRODUCERS || index != next[producer]) {
+                        in_order = false;
+                        break;
+                    }
+                    ++next[producer];
+                    ++received;
+                }
+                // Если проверка провалилась, писатели должны дописать всё, чтобы потоки завершились
+                while (received < PRODUCERS * ITEMS_PER_PRODUCER) {
+                    if (queue.TryPop()) {
+                        ++received;
+                    }
+                }
+            }
+
+            THEN("each item is popped exactly once, in the order of its producer") {
+                INFO("rejected pushes: " << rejected.load());
+                CHECK(in_order);
+                CHECK(received == PRODUCERS * ITEMS_PER_PRODUCER);
+                CHECK_FALSE(queue.TryPop());
+            }
+        }
+    }
+}
+
+SCENARIO("Tick engine") {
+    GIVEN("a running engine") {
+        CounterEngine engine{ 1ms, 128, Counter{}, StepCounter };
+        const auto initial = engine.GetSnapshot();
+
+        WHEN("actions are submitted") {
+            for (std::uint64_t value = 1; value <= 100; ++value) {
+                REQUIRE(engine.Submit(std::uint64_t{ value }));
+            }
+
+            THEN("they are applied on the engine thread and a new snapshot is published") {
+                REQUIRE(WaitFor([&engine] {
+                    return engine.GetSnapshot()->actions == 100;
+                    }));
+                const auto snapshot = engine.GetSnapshot();
+                CHECK(snapshot->sum == 5050);
+                CHECK(snapshot->tick > 0);
+                // Серии тактов появляются в выгрузке, как только движок записал первую метрику
+                const std::string scrape = metrics::ScrapePrometheus();
+                CHECK(scrape.find("game_server_ticks_total "sv) != std::string::npos);
+                CHECK(scrape.find("game_server_tick_duration_seconds_count "sv) != std::string::npos);
+
+                AND_THEN("ticks keep advancing while old snapshots stay unchanged") {
+                    CHECK(WaitFor([&engine, &snapshot] {
+                        return engine.GetSnapshot()->tick > snapshot->tick;
+                        }));
+                    CHECK(snapshot->sum == 5050);
+                    CHECK(initial->tick == 0);
+                    CHECK(initial->sum == 0);
+                }
+            }
+        }
+    }
+
+    GIVEN("an engine with a long tick and a small queue") {
+        std::optional<CounterEngine> engine{ std::in_place, 1h, 2, Counter{}, StepCounter };
+
+        THEN("submits beyond the capacity are rejected") {
+            CHECK(engine->Submit(1));
+            CHECK(engine->Submit(2));
+            CHECK_FALSE(engine->Submit(3));
+            CHECK(engine->GetSnapshot()->tick == 0);
+        }
+
+        THEN("the engine stops without waiting for the next tick") {
+            const auto start = std::chrono::steady_clock::now();
+            engine.reset();
+            CHECK(std::chrono::steady_clock::now() - start < WAIT_TIMEOUT);
+        }
+    }
+}
@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "../src/collision_detector.h"
+
+namespace {
+
+using namespace collision_detector;
+
+constexpr size_t ITEM_COUNT = 10'000;
+
+// Предметы на поле 100x100 и короткое перемещение собирателя через его центр
+struct Scene {
+    Scene() {
+        std::mt19937 random{42};
+        std::uniform_real_distribution<double> coord{0.0, 100.0};
+        std::uniform_real_distribution<double> width{0.0, 0.5};
+        for (size_t i = 0; i < ITEM_COUNT; ++i) {
+            x.push_back(coord(random));
+            y.push_back(coord(random));
+            widths.push_back(width(random));
+        }
+        hits.reserve(ITEM_COUNT);
+    }
+
+    ItemColumns Columns() const {
+        return {x, y, widths};
+    }
+
+    geom::Point2D a{40.0, 50.0};
+    geom::Point2D b{60.0, 50.5};
+    double gatherer_width = 0.6;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> widths;
+    std::vector<CollectedItem> hits;
+};
+
+void BM_TryCollectPointLoop(benchmark::State& state) {
+    Scene scene;
+    for (auto _ : state) {
+        scene.hits.clear();
+        for (size_t i = 0; i < ITEM_COUNT; ++i) {
+            const auto result = TryCollectPoint(scene.a, scene.b, {scene.x[i], scene.y[i]});
+            if (result.IsCollected(scene.gatherer_width + scene.widths[i])) {
+                scene.hits.push_back({i, result});
+            }
+        }
+        benchmark::DoNotOptimize(scene.hits.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * ITEM_COUNT));
+}
+
+void BM_TryCollectPointsScalar(benchmark::State& state) {
+    Scene scene;
+    for (auto _ : state) {
+        scene.hits.clear();
+        detail::TryCollectPointsScalar(scene.a, scene.b, scene.gatherer_width, scene.Columns(), scene.hits);
+        benchmark::DoNotOptimize(scene.hits.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * ITEM_COUNT));
+}
+
+void BM_TryCollectPointsAvx2(benchmark::State& state) {
+    if (!detail::HasAvx2()) {
+        state.SkipWithError("AVX2 is not supported");
+        return;
+    }
+    Scene scene;
+    for (auto _ : state) {
+        scene.hits.clear();
+        detail::TryCollectPointsAvx2(scene.a, scene.b, scene.gatherer_width, scene.Columns(), scene.hits);
+        benchmark::DoNotOptimize(scene.hits.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * ITEM_COUNT));
+}
+
+// Тысячи собак и предметов на карте 1000x1000, за ход каждая собака проходит не больше единицы
+class TickProvider : public ItemGathererProvider {
+public:
+    TickProvider(size_t gatherer_count, size_t item_count) {
+        std::mt19937 random{7};
+        std::uniform_real_distribution<double> coord{0.0, 1000.0};
+        std::uniform_real_distribution<double> step{-1.0, 1.0};
+        for (size_t i = 0; i < item_count; ++i) {
+            items_.push_back({{coord(random), coord(random)}, 0.0});
+        }
+        for (size_t i = 0; i < gatherer_count; ++i) {
+            const geom::Point2D start{coord(random), coord(random)};
+            gatherers_.push_back({start, {start.x + step(random), start.y + step(random)}, 0.6});
+        }
+    }
+
+    size_t ItemsCount() const override {
+        return items_.size();
+    }
+
+    Item GetItem(size_t idx) const override {
+        return items_[idx];
+    }
+
+    size_t GatherersCount() const override {
+        return gatherers_.size();
+    }
+
+    Gatherer GetGatherer(size_t idx) const override {
+        return gatherers_[idx];
+    }
+
+    ItemGathererSpans GetSpans() const {
+        return {items_, gatherers_};
+    }
+
+private:
+    std::vector<Item> items_;
+    std::vector<Gatherer> gatherers_;
+};
+
+void BM_FindGatherEvents(benchmark::State& state) {
+    const TickProvider provider{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(0))};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(FindGatherEvents(provider));
+    }
+}
+
+// Те же данные, переданные массивами, без обращений к виртуальному интерфейсу
+void BM_FindGatherEventsSpans(benchmark::State& state) {
+    const TickProvider provider{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(0))};
+    const ItemGathererSpans scene = provider.GetSpans();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(FindGatherEvents(scene));
+    }
+}
+
+// range(1) - число потоков
+void BM_FindGatherEventsParallel(benchmark::State& state) {
+    const TickProvider provider{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(0))};
+    const auto num_threads = static_cast<unsigned>(state.range(1));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(FindGatherEvents(provider, num_threads));
+    }
+}
+
+void BM_FindGatherEventsBruteForce(benchmark::State& state) {
+    const TickProvider provider{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(0))};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(detail::FindGatherEventsBruteForce(provider));
+    }
+}
+
+BENCHMARK(BM_TryCollectPointLoop);
+BENCHMARK(BM_TryCollectPointsScalar);
+BENCHMARK(BM_TryCollectPointsAvx2);
+BENCHMARK(BM_FindGatherEvents)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindGatherEventsSpans)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindGatherEventsParallel)->ArgsProduct({{10'000, 100'000}, {2, 4, 8}})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindGatherEventsBruteForce)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
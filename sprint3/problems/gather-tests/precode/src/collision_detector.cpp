@@ -1,5 +1,16 @@
 #include "collision_detector.h"
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <tuple>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLLISION_DETECTOR_HAS_AVX2_KERNEL 1
+#endif
 
 namespace collision_detector {
 
@@ -22,11 +33,419 @@ CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D
     return CollectionResult(sq_distance, proj_ratio);
 }
 
-// В задании на разработку тестов реализовывать следующую функцию не нужно -
-// она будет линковаться извне.
-/*
+namespace detail {
+
+namespace {
+
+void AssertSameSizes([[maybe_unused]] const ItemColumns& items) {
+    assert(items.x.size() == items.y.size() && items.x.size() == items.width.size());
+}
+
+// Проверка одного предмета теми же операциями, что и в TryCollectPoint
+void CollectOne(geom::Point2D a, double v_x, double v_y, double v_len2, double gatherer_width,
+                const ItemColumns& items, size_t i, std::vector<CollectedItem>& hits) {
+    const double u_x = items.x[i] - a.x;
+    const double u_y = items.y[i] - a.y;
+    const double u_dot_v = u_x * v_x + u_y * v_y;
+    const double u_len2 = u_x * u_x + u_y * u_y;
+    const CollectionResult result(u_len2 - (u_dot_v * u_dot_v) / v_len2, u_dot_v / v_len2);
+    if (result.IsCollected(gatherer_width + items.width[i])) {
+        hits.push_back({i, result});
+    }
+}
+
+}  // namespace
+
+void TryCollectPointsScalar(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemColumns& items,
+                            std::vector<CollectedItem>& hits) {
+    assert(b.x != a.x || b.y != a.y);
+    AssertSameSizes(items);
+    const double v_x = b.x - a.x;
+    const double v_y = b.y - a.y;
+    const double v_len2 = v_x * v_x + v_y * v_y;
+    for (size_t i = 0; i < items.x.size(); ++i) {
+        CollectOne(a, v_x, v_y, v_len2, gatherer_width, items, i, hits);
+    }
+}
+
+#ifdef COLLISION_DETECTOR_HAS_AVX2_KERNEL
+
+// По четыре предмета за итерацию. Умножения и сложения идут раздельно, без FMA, в том же порядке,
+// что и в скалярном коде, поэтому результаты совпадают с ним точно
+__attribute__((target("avx2")))
+void TryCollectPointsAvx2(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemColumns& items,
+                          std::vector<CollectedItem>& hits) {
+    assert(b.x != a.x || b.y != a.y);
+    AssertSameSizes(items);
+    const double v_x = b.x - a.x;
+    const double v_y = b.y - a.y;
+    const double v_len2 = v_x * v_x + v_y * v_y;
+
+    const __m256d a_x4 = _mm256_set1_pd(a.x);
+    const __m256d a_y4 = _mm256_set1_pd(a.y);
+    const __m256d v_x4 = _mm256_set1_pd(v_x);
+    const __m256d v_y4 = _mm256_set1_pd(v_y);
+    const __m256d v_len24 = _mm256_set1_pd(v_len2);
+    const __m256d gatherer_width4 = _mm256_set1_pd(gatherer_width);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    const size_t count = items.x.size();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(items.x.data() + i), a_x4);
+        const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(items.y.data() + i), a_y4);
+        const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(u_x, v_x4), _mm256_mul_pd(u_y, v_y4));
+        const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+        const __m256d proj_ratio = _mm256_div_pd(u_dot_v, v_len24);
+        const __m256d sq_distance = _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len24));
+
+        const __m256d radius = _mm256_add_pd(gatherer_width4, _mm256_loadu_pd(items.width.data() + i));
+        const __m256d collected = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(proj_ratio, zero, _CMP_GE_OQ), _mm256_cmp_pd(proj_ratio, one, _CMP_LE_OQ)),
+            _mm256_cmp_pd(sq_distance, _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+
+        int mask = _mm256_movemask_pd(collected);
+        if (mask == 0) {
+            continue;
+        }
+        alignas(32) double sq_distances[4];
+        alignas(32) double proj_ratios[4];
+        _mm256_store_pd(sq_distances, sq_distance);
+        _mm256_store_pd(proj_ratios, proj_ratio);
+        while (mask != 0) {
+            const int lane = __builtin_ctz(static_cast<unsigned>(mask));
+            hits.push_back({i + lane, CollectionResult(sq_distances[lane], proj_ratios[lane])});
+            mask &= mask - 1;
+        }
+    }
+    for (; i < count; ++i) {
+        CollectOne(a, v_x, v_y, v_len2, gatherer_width, items, i, hits);
+    }
+}
+
+bool HasAvx2() {
+    static const bool has_avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return has_avx2;
+}
+
+#else
+
+void TryCollectPointsAvx2(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemColumns& items,
+                          std::vector<CollectedItem>& hits) {
+    TryCollectPointsScalar(a, b, gatherer_width, items, hits);
+}
+
+bool HasAvx2() {
+    return false;
+}
+
+#endif
+
+}  // namespace detail
+
+void TryCollectPoints(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemColumns& items,
+                      std::vector<CollectedItem>& hits) {
+    if (detail::HasAvx2()) {
+        detail::TryCollectPointsAvx2(a, b, gatherer_width, items, hits);
+    }
+    else {
+        detail::TryCollectPointsScalar(a, b, gatherer_width, items, hits);
+    }
+}
+
+namespace {
+
+bool IsMoving(const Gatherer& gatherer) {
+    return gatherer.start_pos.x != gatherer.end_pos.x || gatherer.start_pos.y != gatherer.end_pos.y;
+}
+
+bool EventLess(const GatheringEvent& lhs, const GatheringEvent& rhs) {
+    return std::tie(lhs.time, lhs.gatherer_id, lhs.item_id) < std::tie(rhs.time, rhs.gatherer_id, rhs.item_id);
+}
+
+void SortEvents(std::vector<GatheringEvent>& events) {
+    std::sort(events.begin(), events.end(), EventLess);
+}
+
+// Предметов на ячейку в среднем
+constexpr double ITEMS_PER_CELL = 4.0;
+// Не больше стольких ячеек на предмет, чтобы разреженное поле не раздувало сетку
+constexpr double MAX_CELLS_PER_ITEM = 4.0;
+
+// Предметы, разложенные по ячейкам равномерной сетки. Каждый предмет лежит в ячейке своего центра.
+// Столбцы отсортированы по ячейкам построчно, поэтому соседние ячейки одной строки сетки
+// образуют непрерывный отрезок столбцов и проверяются одним вызовом TryCollectPoints
+class ItemGrid {
+public:
+    explicit ItemGrid(std::span<const Item> items) {
+        const size_t count = items.size();
+        double min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const Item& item = items[i];
+            if (i == 0) {
+                min_x = max_x = item.position.x;
+                min_y = max_y = item.position.y;
+            }
+            min_x = std::min(min_x, item.position.x);
+            min_y = std::min(min_y, item.position.y);
+            max_x = std::max(max_x, item.position.x);
+            max_y = std::max(max_y, item.position.y);
+            max_width_ = std::max(max_width_, item.width);
+        }
+        if (count == 0) {
+            return;
+        }
+
+        origin_x_ = min_x;
+        origin_y_ = min_y;
+        const double width = max_x - min_x;
+        const double height = max_y - min_y;
+        cell_size_ = std::sqrt(std::max(width * height, 1.0) * ITEMS_PER_CELL / static_cast<double>(count));
+        while ((width / cell_size_ + 1) * (height / cell_size_ + 1) > MAX_CELLS_PER_ITEM * static_cast<double>(count) + 1) {
+            cell_size_ *= 1.5;
+        }
+        columns_ = CellX(max_x) + 1;
+        rows_ = CellY(max_y) + 1;
+
+        // Сортировка подсчётом по номеру ячейки
+        cell_starts_.assign(static_cast<size_t>(columns_ * rows_) + 1, 0);
+        std::vector<size_t> cells(count);
+        for (size_t i = 0; i < count; ++i) {
+            cells[i] = static_cast<size_t>(CellY(items[i].position.y) * columns_ + CellX(items[i].position.x));
+            ++cell_starts_[cells[i] + 1];
+        }
+        for (size_t i = 1; i < cell_starts_.size(); ++i) {
+            cell_starts_[i] += cell_starts_[i - 1];
+        }
+        x_.resize(count);
+        y_.resize(count);
+        widths_.resize(count);
+        ids_.resize(count);
+        std::vector<size_t> fill(cell_starts_.begin(), cell_starts_.end() - 1);
+        for (size_t i = 0; i < count; ++i) {
+            const size_t slot = fill[cells[i]]++;
+            x_[slot] = items[i].position.x;
+            y_[slot] = items[i].position.y;
+            widths_[slot] = items[i].width;
+            ids_[slot] = i;
+        }
+    }
+
+    double GetMaxWidth() const {
+        return max_width_;
+    }
+
+    // Для каждой строки сетки, задетой прямоугольником, вызывает fn(columns, first_slot) с предметами
+    // задетых ячеек этой строки. first_slot - номер первого из них в общих столбцах
+    template <typename Fn>
+    void ForEachRowInBox(double min_x, double min_y, double max_x, double max_y, Fn&& fn) const {
+        if (ids_.empty()) {
+            return;
+        }
+        const auto first_column = std::max<std::int64_t>(CellX(min_x), 0);
+        const auto last_column = std::min<std::int64_t>(CellX(max_x), columns_ - 1);
+        const auto first_row = std::max<std::int64_t>(CellY(min_y), 0);
+        const auto last_row = std::min<std::int64_t>(CellY(max_y), rows_ - 1);
+        if (first_column > last_column) {
+            return;
+        }
+        for (auto row = first_row; row <= last_row; ++row) {
+            const size_t begin = cell_starts_[static_cast<size_t>(row * columns_ + first_column)];
+            const size_t end = cell_starts_[static_cast<size_t>(row * columns_ + last_column) + 1];
+            if (begin == end) {
+                continue;
+            }
+            const size_t size = end - begin;
+            fn(ItemColumns{std::span{x_}.subspan(begin, size), std::span{y_}.subspan(begin, size),
+                           std::span{widths_}.subspan(begin, size)},
+               begin);
+        }
+    }
+
+    size_t GetItemId(size_t slot) const {
+        return ids_[slot];
+    }
+
+private:
+    // Номер ячейки по координате. Координаты за пределами сетки дают номера вне [0, columns_)
+    std::int64_t CellX(double x) const {
+        return ToCell((x - origin_x_) / cell_size_);
+    }
+
+    std::int64_t CellY(double y) const {
+        return ToCell((y - origin_y_) / cell_size_);
+    }
+
+    static std::int64_t ToCell(double offset) {
+        // Ограничение защищает от переполнения при очень далёких или бесконечных координатах
+        constexpr double LIMIT = 1e15;
+        return static_cast<std::int64_t>(std::floor(std::clamp(offset, -LIMIT, LIMIT)));
+    }
+
+    double origin_x_ = 0;
+    double origin_y_ = 0;
+    double cell_size_ = 1;
+    double max_width_ = 0;
+    std::int64_t columns_ = 0;
+    std::int64_t rows_ = 0;
+    std::vector<size_t> cell_starts_;
+    std::vector<double> x_;
+    std::vector<double> y_;
+    std::vector<double> widths_;
+    std::vector<size_t> ids_;
+};
+
+// Узкая фаза для одного собирателя: точная проверка предметов из ячеек, задетых его путём
+void CollectGathererEvents(const ItemGrid& grid, size_t gatherer_id, const Gatherer& gatherer,
+                           std::vector<CollectedItem>& hits, std::vector<GatheringEvent>& events) {
+    if (!IsMoving(gatherer)) {
+        return;
+    }
+    // Предмет может быть собран, только если его центр ближе к пути, чем сумма ширин.
+    // Небольшой запас покрывает ошибки округления в TryCollectPoint у самой границы
+    const double length = std::abs(gatherer.end_pos.x - gatherer.start_pos.x) + std::abs(gatherer.end_pos.y - gatherer.start_pos.y);
+    const double width_sum = gatherer.width + grid.GetMaxWidth();
+    const double reach = width_sum + 1e-6 * (width_sum + length + 1.0);
+    const double min_x = std::min(gatherer.start_pos.x, gatherer.end_pos.x) - reach;
+    const double min_y = std::min(gatherer.start_pos.y, gatherer.end_pos.y) - reach;
+    const double max_x = std::max(gatherer.start_pos.x, gatherer.end_pos.x) + reach;
+    const double max_y = std::max(gatherer.start_pos.y, gatherer.end_pos.y) + reach;
+
+    grid.ForEachRowInBox(min_x, min_y, max_x, max_y, [&](const ItemColumns& columns, size_t first_slot) {
+        hits.clear();
+        TryCollectPoints(gatherer.start_pos, gatherer.end_pos, gatherer.width, columns, hits);
+        for (const auto& hit : hits) {
+            events.push_back({grid.GetItemId(first_slot + hit.item_id), gatherer_id, hit.result.sq_distance,
+                              hit.result.proj_ratio});
+        }
+    });
+}
+
+// Собиратели раздаются потокам порциями такого размера
+constexpr size_t GATHERERS_PER_TASK = 256;
+
+}  // namespace
+
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererSpans& scene) {
+    const ItemGrid grid{scene.items};
+    std::vector<GatheringEvent> events;
+    std::vector<CollectedItem> hits;
+
+    for (size_t gatherer_id = 0; gatherer_id < scene.gatherers.size(); ++gatherer_id) {
+        CollectGathererEvents(grid, gatherer_id, scene.gatherers[gatherer_id], hits, events);
+    }
+
+    SortEvents(events);
+    return events;
+}
+
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererSpans& scene, unsigned num_threads) {
+    const size_t gatherer_count = scene.gatherers.size();
+    const size_t task_count = (gatherer_count + GATHERERS_PER_TASK - 1) / GATHERERS_PER_TASK;
+    const size_t worker_count = std::min<size_t>(num_threads, task_count);
+    if (worker_count <= 1) {
+        return FindGatherEvents(scene);
+    }
+
+    const ItemGrid grid{scene.items};
+
+    // Каждый поток берёт очередную порцию собирателей и копит события в своём буфере
+    std::vector<std::vector<GatheringEvent>> buffers(worker_count);
+    std::atomic<size_t> next_task{0};
+    const auto work = [&](std::vector<GatheringEvent>& events) {
+        std::vector<CollectedItem> hits;
+        for (size_t task = next_task++; task < task_count; task = next_task++) {
+            const size_t last = std::min(gatherer_count, (task + 1) * GATHERERS_PER_TASK);
+            for (size_t gatherer_id = task * GATHERERS_PER_TASK; gatherer_id < last; ++gatherer_id) {
+                CollectGathererEvents(grid, gatherer_id, scene.gatherers[gatherer_id], hits, events);
+            }
+        }
+        std::sort(events.begin(), events.end(), EventLess);
+    };
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(worker_count - 1);
+        for (size_t i = 1; i < worker_count; ++i) {
+            workers.emplace_back(work, std::ref(buffers[i]));
+        }
+        work(buffers[0]);
+    }
+
+    // Слияние отсортированных буферов. Порядок (time, gatherer_id, item_id) полный, поэтому
+    // результат не зависит от того, какие собиратели достались каким потокам
+    std::vector<size_t> bounds{0};
+    std::vector<GatheringEvent> events;
+    for (const auto& buffer : buffers) {
+        events.insert(events.end(), buffer.begin(), buffer.end());
+        bounds.push_back(events.size());
+    }
+    for (size_t width = 1; width < buffers.size(); width *= 2) {
+        for (size_t i = 0; i + width < buffers.size(); i += 2 * width) {
+            const size_t last = std::min(i + 2 * width, buffers.size());
+            std::inplace_merge(events.begin() + static_cast<std::ptrdiff_t>(bounds[i]),
+                               events.begin() + static_cast<std::ptrdiff_t>(bounds[i + width]),
+                               events.begin() + static_cast<std::ptrdiff_t>(bounds[last]), EventLess);
+        }
+    }
+    return events;
+}
+
+namespace {
+
+// Копия содержимого провайдера: по одному виртуальному вызову на элемент
+struct ProviderCopy {
+    explicit ProviderCopy(const ItemGathererProvider& provider) {
+        items.reserve(provider.ItemsCount());
+        for (size_t i = 0, count = provider.ItemsCount(); i < count; ++i) {
+            items.push_back(provider.GetItem(i));
+        }
+        gatherers.reserve(provider.GatherersCount());
+        for (size_t i = 0, count = provider.GatherersCount(); i < count; ++i) {
+            gatherers.push_back(provider.GetGatherer(i));
+        }
+    }
+
+    ItemGathererSpans GetSpans() const {
+        return {items, gatherers};
+    }
+
+    std::vector<Item> items;
+    std::vector<Gatherer> gatherers;
+};
+
+}  // namespace
+
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
+    return FindGatherEvents(ProviderCopy{provider}.GetSpans());
+}
+
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider, unsigned num_threads) {
+    // Провайдер читается только из вызывающего потока, поэтому ему не нужно быть потокобезопасным
+    return FindGatherEvents(ProviderCopy{provider}.GetSpans(), num_threads);
 }
-*/
+
+namespace detail {
+
+std::vector<GatheringEvent> FindGatherEventsBruteForce(const ItemGathererProvider& provider) {
+    std::vector<GatheringEvent> events;
+    for (size_t gatherer_id = 0; gatherer_id < provider.GatherersCount(); ++gatherer_id) {
+        const Gatherer gatherer = provider.GetGatherer(gatherer_id);
+        if (!IsMoving(gatherer)) {
+            continue;
+        }
+        for (size_t item_id = 0; item_id < provider.ItemsCount(); ++item_id) {
+            const Item item = provider.GetItem(item_id);
+            const auto result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
+            if (result.IsCollected(gatherer.width + item.width)) {
+                events.push_back({item_id, gatherer_id, result.sq_distance, result.proj_ratio});
+            }
+        }
+    }
+    SortEvents(events);
+    return events;
+}
+
+}  // namespace detail
 
 }  // namespace collision_detector
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <span>
 #include <vector>
 
 namespace collision_detector {
@@ -28,6 +29,38 @@ struct Item {
     double width;
 };
 
+// Предметы в виде структуры массивов: i-й предмет находится в (x[i], y[i]) и имеет ширину width[i].
+// Все три массива одной длины.
+struct ItemColumns {
+    std::span<const double> x;
+    std::span<const double> y;
+    std::span<const double> width;
+};
+
+struct CollectedItem {
+    size_t item_id;
+    CollectionResult result;
+};
+
+// Пакетный вариант TryCollectPoint: движемся из a в b и пытаемся подобрать все предметы items разом.
+// Дописывает в hits предметы, для которых IsCollected(gatherer_width + width[i]), по возрастанию номера.
+// Значения sq_distance и proj_ratio совпадают с TryCollectPoint бит в бит.
+// Использует AVX2, если процессор его поддерживает, иначе - скалярный цикл.
+void TryCollectPoints(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemColumns& items,
+                      std::vector<CollectedItem>& hits);
+
+namespace detail {
+
+// Реализации TryCollectPoints, доступные для тестов и замеров
+void TryCollectPointsScalar(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemColumns& items,
+                            std::vector<CollectedItem>& hits);
+// Вызывать только при HasAvx2() == true
+void TryCollectPointsAvx2(geom::Point2D a, geom::Point2D b, double gatherer_width, const ItemColumns& items,
+                          std::vector<CollectedItem>& hits);
+bool HasAvx2();
+
+}  // namespace detail
+
 struct Gatherer {
     geom::Point2D start_pos;
     geom::Point2D end_pos;
@@ -45,6 +78,14 @@ public:
     virtual Gatherer GetGatherer(size_t idx) const = 0;
 };
 
+// Предметы и собиратели хода, уже лежащие в памяти подряд. Для FindGatherEvents это быстрый путь:
+// элементы читаются без виртуальных вызовов и копирования. Номера предметов и собирателей в событиях -
+// индексы в этих массивах
+struct ItemGathererSpans {
+    std::span<const Item> items;
+    std::span<const Gatherer> gatherers;
+};
+
 struct GatheringEvent {
     size_t item_id;
     size_t gatherer_id;
@@ -52,8 +93,27 @@ struct GatheringEvent {
     double time;
 };
 
-// Эту функцию вам нужно будет реализовать в соответствующем задании.
-// При проверке ваших тестов она не нужна - функция будет линковаться снаружи.
+// События сбора предметов собирателями за ход, упорядоченные по time, затем по gatherer_id и item_id.
+// Собиратель с нулевым перемещением ничего не собирает.
+// Предметы раскладываются по равномерной сетке, и каждый собиратель точно проверяется только
+// с предметами из ячеек, которые задевает его путь, расширенный на ширины. Результат совпадает
+// с полным перебором, включая значения sq_distance и time.
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererSpans& scene);
+
+// То же на num_threads потоках: собиратели делятся между потоками порциями, события каждого потока
+// сортируются и затем сливаются. Результат в точности совпадает с однопоточным вариантом.
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererSpans& scene, unsigned num_threads);
+
+// Варианты для произвольного провайдера. Его содержимое один раз копируется в массивы,
+// провайдер опрашивается только из вызывающего потока
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider, unsigned num_threads);
+
+namespace detail {
+
+// Полный перебор всех пар собиратель-предмет. Эталон для проверки FindGatherEvents
+std::vector<GatheringEvent> FindGatherEventsBruteForce(const ItemGathererProvider& provider);
+
+}  // namespace detail
 
 }  // namespace collision_detector
\ No newline at end of file
@@ -1,5 +1,271 @@
 #define _USE_MATH_DEFINES
 
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <random>
+#include <tuple>
+#include <vector>
+
 #include "../src/collision_detector.h"
 
-// Напишите здесь тесты для функции collision_detector::FindGatherEvents
\ No newline at end of file
+// Напишите здесь тесты для функции collision_detector::FindGatherEvents
+
+namespace {
+
+using namespace collision_detector;
+
+// Результат поштучного TryCollectPoint - эталон для пакетной проверки
+std::vector<CollectedItem> CollectOneByOne(geom::Point2D a, geom::Point2D b, double gatherer_width,
+                                           const ItemColumns& items) {
+    std::vector<CollectedItem> hits;
+    for (size_t i = 0; i < items.x.size(); ++i) {
+        const auto result = TryCollectPoint(a, b, {items.x[i], items.y[i]});
+        if (result.IsCollected(gatherer_width + items.width[i])) {
+            hits.push_back({i, result});
+        }
+    }
+    return hits;
+}
+
+bool SameHits(const std::vector<CollectedItem>& lhs, const std::vector<CollectedItem>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        // Значения должны совпадать точно, а не приближённо
+        if (lhs[i].item_id != rhs[i].item_id || lhs[i].result.sq_distance != rhs[i].result.sq_distance
+            || lhs[i].result.proj_ratio != rhs[i].result.proj_ratio) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST_CASE("TryCollectPoints matches TryCollectPoint for every item") {
+    std::mt19937 random{2023};
+    std::uniform_real_distribution<double> coord{-10.0, 10.0};
+    std::uniform_real_distribution<double> width{0.0, 3.0};
+
+    // Разные длины проверяют и векторную часть, и скалярный хвост
+    for (size_t count = 0; count < 70; ++count) {
+        std::vector<double> x, y, widths;
+        for (size_t i = 0; i < count; ++i) {
+            x.push_back(coord(random));
+            y.push_back(coord(random));
+            widths.push_back(width(random));
+        }
+        const ItemColumns items{x, y, widths};
+        const geom::Point2D a{coord(random), coord(random)};
+        const geom::Point2D b{coord(random), coord(random)};
+        const double gatherer_width = width(random);
+
+        const auto expected = CollectOneByOne(a, b, gatherer_width, items);
+
+        std::vector<CollectedItem> hits;
+        TryCollectPoints(a, b, gatherer_width, items, hits);
+        CHECK(SameHits(hits, expected));
+
+        hits.clear();
+        detail::TryCollectPointsScalar(a, b, gatherer_width, items, hits);
+        CHECK(SameHits(hits, expected));
+
+        if (detail::HasAvx2()) {
+            hits.clear();
+            detail::TryCollectPointsAvx2(a, b, gatherer_width, items, hits);
+            CHECK(SameHits(hits, expected));
+        }
+    }
+}
+
+TEST_CASE("TryCollectPoints appends hits in item order") {
+    const std::vector<double> x{5, 0, 3, 10, 11, 2, 7};
+    const std::vector<double> y{0, 0, 1, 0, 0, -5, -0.5};
+    const std::vector<double> widths{0, 0, 0, 0, 0, 0, 0.1};
+
+    std::vector<CollectedItem> hits{{100, {0, 0}}};
+    TryCollectPoints({0, 0}, {10, 0}, 0.6, {x, y, widths}, hits);
+
+    std::vector<size_t> ids;
+    for (const auto& hit : hits) {
+        ids.push_back(hit.item_id);
+    }
+    CHECK(ids == std::vector<size_t>{100, 0, 1, 3, 6});
+}
+
+namespace {
+
+class TestProvider : public ItemGathererProvider {
+public:
+    TestProvider(std::vector<Item> items, std::vector<Gatherer> gatherers)
+        : items_(std::move(items))
+        , gatherers_(std::move(gatherers)) {
+    }
+
+    size_t ItemsCount() const override {
+        return items_.size();
+    }
+
+    Item GetItem(size_t idx) const override {
+        return items_.at(idx);
+    }
+
+    size_t GatherersCount() const override {
+        return gatherers_.size();
+    }
+
+    Gatherer GetGatherer(size_t idx) const override {
+        return gatherers_.at(idx);
+    }
+
+private:
+    std::vector<Item> items_;
+    std::vector<Gatherer> gatherers_;
+};
+
+bool SameEvents(const std::vector<GatheringEvent>& lhs, const std::vector<GatheringEvent>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs[i].item_id != rhs[i].item_id || lhs[i].gatherer_id != rhs[i].gatherer_id
+            || lhs[i].sq_distance != rhs[i].sq_distance || lhs[i].time != rhs[i].time) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST_CASE("FindGatherEvents returns nothing without items or gatherers") {
+    CHECK(FindGatherEvents(TestProvider{{}, {}}).empty());
+    CHECK(FindGatherEvents(TestProvider{{{{0, 0}, 1}}, {}}).empty());
+    CHECK(FindGatherEvents(TestProvider{{}, {{{0, 0}, {10, 0}, 1}}}).empty());
+}
+
+TEST_CASE("FindGatherEvents ignores gatherers that do not move") {
+    CHECK(FindGatherEvents(TestProvider{{{{0, 0}, 1}}, {{{0, 0}, {0, 0}, 1}}}).empty());
+}
+
+TEST_CASE("FindGatherEvents collects items within the sum of widths") {
+    const TestProvider provider{{{{5, 0.9}, 0.3}, {{5, 1.0}, 0.3}, {{5, -1.0}, 0.2}, {{-0.1, 0}, 1.0}, {{10.1, 0}, 1.0}},
+                                {{{0, 0}, {10, 0}, 0.6}}};
+    const auto events = FindGatherEvents(provider);
+
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].item_id == 0);
+    CHECK(events[0].gatherer_id == 0);
+    CHECK(events[0].time == 0.5);
+    CHECK(std::abs(events[0].sq_distance - 0.81) < 1e-10);
+}
+
+TEST_CASE("FindGatherEvents orders events by time, then gatherer and item") {
+    const TestProvider provider{{{{8, 0}, 0}, {{2, 0}, 0}, {{5, 0}, 0}, {{5, 0}, 0}},
+                                {{{0, 0}, {10, 0}, 0.5}, {{10, 0}, {0, 0}, 0.5}}};
+    const auto events = FindGatherEvents(provider);
+
+    std::vector<std::tuple<double, size_t, size_t>> order;
+    for (const auto& event : events) {
+        order.emplace_back(event.time, event.gatherer_id, event.item_id);
+    }
+    CHECK(order == std::vector<std::tuple<double, size_t, size_t>>{
+                       {0.2, 0, 1}, {0.2, 1, 0}, {0.5, 0, 2}, {0.5, 0, 3}, {0.5, 1, 2}, {0.5, 1, 3}, {0.8, 0, 0}, {0.8, 1, 1}});
+}
+
+TEST_CASE("FindGatherEvents matches brute force on random scenes") {
+    std::mt19937 random{7};
+    for (int scene = 0; scene < 300; ++scene) {
+        const double field = std::uniform_real_distribution<double>{1.0, 200.0}(random);
+        std::uniform_real_distribution<double> coord{-field, field};
+        std::uniform_real_distribution<double> step{-field / 10, field / 10};
+        std::uniform_real_distribution<double> width{0.0, 2.0};
+        const size_t item_count = std::uniform_int_distribution<size_t>{0, 300}(random);
+        const size_t gatherer_count = std::uniform_int_distribution<size_t>{0, 60}(random);
+
+        std::vector<Item> items;
+        for (size_t i = 0; i < item_count; ++i) {
+            items.push_back({{coord(random), coord(random)}, width(random)});
+        }
+        std::vector<Gatherer> gatherers;
+        for (size_t i = 0; i < gatherer_count; ++i) {
+            const geom::Point2D start{coord(random), coord(random)};
+            switch (random() % 4) {
+            case 0:
+                // Стоит на месте
+                gatherers.push_back({start, start, width(random)});
+                break;
+            case 1:
+                // Движется по оси, как собаки по дорогам
+                gatherers.push_back({start, {start.x + step(random), start.y}, width(random)});
+                break;
+            default:
+                gatherers.push_back({start, {start.x + step(random), start.y + step(random)}, width(random)});
+                break;
+            }
+        }
+        // Часть предметов ставим ровно на концы путей и на их продолжения
+        for (size_t i = 0; i < gatherers.size() && i < items.size(); i += 3) {
+            items[i].position = (i % 2 == 0) ? gatherers[i].end_pos : gatherers[i].start_pos;
+        }
+
+        const TestProvider provider{std::move(items), std::move(gatherers)};
+        const auto expected = detail::FindGatherEventsBruteForce(provider);
+        const auto actual = FindGatherEvents(provider);
+        CHECK(SameEvents(actual, expected));
+    }
+}
+
+TEST_CASE("Multithreaded FindGatherEvents matches the single-threaded result") {
+    std::mt19937 random{11};
+    std::uniform_real_distribution<double> coord{0.0, 300.0};
+    std::uniform_real_distribution<double> step{-2.0, 2.0};
+    std::uniform_real_distribution<double> width{0.0, 0.6};
+    for (int scene = 0; scene < 20; ++scene) {
+        std::vector<Item> items;
+        for (int i = 0; i < 3000; ++i) {
+            items.push_back({{coord(random), coord(random)}, width(random)});
+        }
+        std::vector<Gatherer> gatherers;
+        for (int i = 0; i < 2000; ++i) {
+            const geom::Point2D start{coord(random), coord(random)};
+            gatherers.push_back({start, {start.x + step(random), start.y + step(random)}, width(random)});
+        }
+        // Несколько собирателей с одинаковыми путями дают события с равным time
+        for (int i = 0; i + 1 < 2000; i += 97) {
+            gatherers[i + 1] = gatherers[i];
+        }
+        const TestProvider provider{std::move(items), std::move(gatherers)};
+
+        const auto expected = FindGatherEvents(provider);
+        for (unsigned threads : {1u, 2u, 3u, 8u}) {
+            CHECK(SameEvents(FindGatherEvents(provider, threads), expected));
+        }
+    }
+}
+
+TEST_CASE("FindGatherEvents over spans matches the provider overload") {
+    std::mt19937 random{13};
+    std::uniform_real_distribution<double> coord{0.0, 100.0};
+    std::uniform_real_distribution<double> step{-3.0, 3.0};
+    std::uniform_real_distribution<double> width{0.0, 0.8};
+    std::vector<Item> items;
+    for (int i = 0; i < 2000; ++i) {
+        items.push_back({{coord(random), coord(random)}, width(random)});
+    }
+    std::vector<Gatherer> gatherers;
+    for (int i = 0; i < 1000; ++i) {
+        const geom::Point2D start{coord(random), coord(random)};
+        gatherers.push_back({start, {start.x + step(random), start.y + step(random)}, width(random)});
+    }
+    const ItemGathererSpans scene{items, gatherers};
+    const TestProvider provider{items, gatherers};
+
+    const auto expected = FindGatherEvents(provider);
+    CHECK(!expected.empty());
+    CHECK(SameEvents(FindGatherEvents(scene), expected));
+    CHECK(SameEvents(FindGatherEvents(scene, 4), expected));
+    CHECK(FindGatherEvents(ItemGathererSpans{}).empty());
+}
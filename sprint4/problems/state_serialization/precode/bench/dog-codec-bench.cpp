@@ -0,0 +1,113 @@
+#include <benchmark/benchmark.h>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/dog_codec.h"
+#include "../src/model_serialization.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+// Собаки с рюкзаками, заполненными наполовину, и повторяющимися именами
+std::vector<DogPtr> MakeDogs(size_t count) {
+    std::mt19937 random{3};
+    std::uniform_real_distribution<double> coord{0.0, 1000.0};
+    std::vector<DogPtr> dogs;
+    dogs.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto dog = std::make_shared<Dog>(Dog::Id{static_cast<uint32_t>(i)}, "Player "s + std::to_string(i % 1000),
+                                         geom::Point2D{coord(random), coord(random)}, 6);
+        dog->SetSpeed({coord(random), coord(random)});
+        dog->AddScore(static_cast<Score>(i));
+        for (uint32_t j = 0; j < 3; ++j) {
+            [[maybe_unused]] const bool put = dog->PutToBag({FoundObject::Id{static_cast<uint32_t>(i * 3 + j)}, j});
+        }
+        dogs.push_back(std::move(dog));
+    }
+    return dogs;
+}
+
+std::string BoostEncode(const std::vector<DogPtr>& dogs) {
+    std::ostringstream out(std::ios::binary);
+    boost::archive::binary_oarchive ar{out};
+    std::vector<serialization::DogRepr> reprs;
+    reprs.reserve(dogs.size());
+    for (const auto& dog : dogs) {
+        reprs.emplace_back(*dog);
+    }
+    ar << reprs;
+    return std::move(out).str();
+}
+
+void BM_BoostSave(benchmark::State& state) {
+    const auto dogs = MakeDogs(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(BoostEncode(dogs));
+    }
+    state.counters["bytes"] = static_cast<double>(BoostEncode(dogs).size());
+}
+
+void BM_BoostRestore(benchmark::State& state) {
+    const std::string data = BoostEncode(MakeDogs(static_cast<size_t>(state.range(0))));
+    for (auto _ : state) {
+        std::istringstream in(data, std::ios::binary);
+        boost::archive::binary_iarchive ar{in};
+        std::vector<serialization::DogRepr> reprs;
+        ar >> reprs;
+        std::vector<Dog> dogs;
+        dogs.reserve(reprs.size());
+        for (const auto& repr : reprs) {
+            dogs.push_back(repr.Restore());
+        }
+        benchmark::DoNotOptimize(dogs);
+    }
+}
+
+void BM_CodecSave(benchmark::State& state) {
+    const auto dogs = MakeDogs(static_cast<size_t>(state.range(0)));
+    std::string buffer;
+    for (auto _ : state) {
+        serialization::EncodeDogs(dogs, buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.counters["bytes"] = static_cast<double>(buffer.size());
+}
+
+// Только разбор в плоские массивы, без сборки объектов Dog
+void BM_CodecDecode(benchmark::State& state) {
+    std::string buffer;
+    serialization::EncodeDogs(MakeDogs(static_cast<size_t>(state.range(0))), buffer);
+    serialization::DecodedDogs decoded;
+    for (auto _ : state) {
+        serialization::DecodeDogs(buffer, decoded);
+        benchmark::DoNotOptimize(decoded.GetCount());
+    }
+}
+
+void BM_CodecRestore(benchmark::State& state) {
+    std::string buffer;
+    serialization::EncodeDogs(MakeDogs(static_cast<size_t>(state.range(0))), buffer);
+    serialization::DecodedDogs decoded;
+    for (auto _ : state) {
+        serialization::DecodeDogs(buffer, decoded);
+        benchmark::DoNotOptimize(decoded.RestoreAll());
+    }
+}
+
+BENCHMARK(BM_BoostSave)->Arg(100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CodecSave)->Arg(100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BoostRestore)->Arg(100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CodecDecode)->Arg(100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CodecRestore)->Arg(100'000)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
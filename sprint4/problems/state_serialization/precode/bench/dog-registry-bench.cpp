@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/dog_registry.h"
+#include "../src/model.h"
+#include "../src/movement.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+constexpr double TICK_SECONDS = 0.05;
+constexpr size_t BAG_CAPACITY = 3;
+
+struct DogSample {
+    geom::Point2D pos;
+    geom::Vec2D speed;
+};
+
+std::vector<DogSample> MakeSamples(size_t count) {
+    std::mt19937 random{5};
+    std::uniform_real_distribution<double> coord{0.0, 1000.0};
+    std::uniform_real_distribution<double> speed{-3.0, 3.0};
+    std::vector<DogSample> samples(count);
+    for (auto& sample : samples) {
+        sample = {{coord(random), coord(random)}, {speed(random), speed(random)}};
+    }
+    return samples;
+}
+
+// Собаки создаются вперемешку с другими объектами в куче, как в работающем сервере
+std::vector<DogPtr> MakeSharedDogs(const std::vector<DogSample>& samples) {
+    std::vector<DogPtr> dogs;
+    std::vector<std::string> garbage;
+    dogs.reserve(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        auto dog = std::make_shared<Dog>(Dog::Id{static_cast<uint32_t>(i)}, "Player "s + std::to_string(i),
+                                         samples[i].pos, BAG_CAPACITY);
+        dog->SetSpeed(samples[i].speed);
+        dogs.push_back(std::move(dog));
+        garbage.emplace_back(64, 'x');
+    }
+    std::shuffle(dogs.begin(), dogs.end(), std::mt19937{6});
+    return dogs;
+}
+
+void BM_TickSharedPtrDogs(benchmark::State& state) {
+    const auto dogs = MakeSharedDogs(MakeSamples(static_cast<size_t>(state.range(0))));
+    for (auto _ : state) {
+        for (const auto& dog : dogs) {
+            dog->SetPosition(dog->GetPosition() + dog->GetSpeed() * TICK_SECONDS);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_TickRegistry(benchmark::State& state) {
+    const auto samples = MakeSamples(static_cast<size_t>(state.range(0)));
+    DogRegistry registry{BAG_CAPACITY};
+    registry.Reserve(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        registry.Add(Dog::Id{static_cast<uint32_t>(i)}, "Player "s + std::to_string(i), samples[i].pos);
+        registry.SetSpeed(i, samples[i].speed);
+    }
+    for (auto _ : state) {
+        const auto columns = registry.GetMovementColumns();
+        for (size_t i = 0; i < columns.x.size(); ++i) {
+            columns.x[i] += columns.speed_x[i] * TICK_SECONDS;
+            columns.y[i] += columns.speed_y[i] * TICK_SECONDS;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Ход с ограничением дорогой: у каждой собаки свой прямоугольник, в который она упирается
+struct BoundsColumns {
+    explicit BoundsColumns(const std::vector<DogSample>& samples) {
+        for (const auto& sample : samples) {
+            min_x.push_back(sample.pos.x - 20.0);
+            min_y.push_back(sample.pos.y - 0.4);
+            max_x.push_back(sample.pos.x + 20.0);
+            max_y.push_back(sample.pos.y + 0.4);
+        }
+    }
+
+    MovementBounds Get() const {
+        return {min_x, min_y, max_x, max_y};
+    }
+
+    std::vector<double> min_x, min_y, max_x, max_y;
+};
+
+void BM_MoveSharedPtrDogs(benchmark::State& state) {
+    const auto samples = MakeSamples(static_cast<size_t>(state.range(0)));
+    const auto dogs = MakeSharedDogs(samples);
+    const BoundsColumns bounds{samples};
+    for (auto _ : state) {
+        for (const auto& dog : dogs) {
+            const size_t i = *dog->GetId();
+            const auto new_pos = dog->GetPosition() + dog->GetSpeed() * TICK_SECONDS;
+            const geom::Point2D pos{std::clamp(new_pos.x, bounds.min_x[i], bounds.max_x[i]),
+                                    std::clamp(new_pos.y, bounds.min_y[i], bounds.max_y[i])};
+            dog->SetPosition(pos);
+            if (pos != new_pos) {
+                dog->SetSpeed({});
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <void (*Integrate)(const DogRegistry::MovementColumns&, const MovementBounds&, double)>
+void BM_MoveRegistry(benchmark::State& state) {
+    const auto samples = MakeSamples(static_cast<size_t>(state.range(0)));
+    DogRegistry registry{BAG_CAPACITY};
+    registry.Reserve(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        registry.Add(Dog::Id{static_cast<uint32_t>(i)}, "Player "s + std::to_string(i), samples[i].pos);
+        registry.SetSpeed(i, samples[i].speed);
+    }
+    const BoundsColumns bounds{samples};
+    for (auto _ : state) {
+        Integrate(registry.GetMovementColumns(), bounds.Get(), TICK_SECONDS);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_TickSharedPtrDogs)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TickRegistry)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MoveSharedPtrDogs)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MoveRegistry, detail::IntegrateMovementScalar)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MoveRegistry, IntegrateMovement)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
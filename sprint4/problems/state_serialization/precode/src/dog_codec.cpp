@@ -0,0 +1,293 @@
+#include "dog_codec.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace serialization {
+using namespace std::literals;
+
+namespace {
+
+constexpr std::array<char, 4> MAGIC = {'D', 'O', 'G', 'C'};
+constexpr size_t HEADER_SIZE = MAGIC.size() + 4 * sizeof(uint32_t);
+// Varint-кодирование uint32 занимает не больше 5 байт
+constexpr size_t MAX_VARINT_SIZE = 5;
+
+uint32_t CheckedU32(size_t value) {
+    if (value > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Value does not fit into the dog record");
+    }
+    return static_cast<uint32_t>(value);
+}
+
+class Writer {
+public:
+    explicit Writer(std::string& out)
+        : out_(out) {
+    }
+
+    template <typename T>
+    void PutFixed(T value) {
+        using U = std::conditional_t<sizeof(T) == 8, uint64_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint8_t>>;
+        auto bits = std::bit_cast<U>(value);
+        if constexpr (std::endian::native == std::endian::little) {
+            out_.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+        } else {
+            for (size_t i = 0; i < sizeof(U); ++i) {
+                out_.push_back(static_cast<char>(bits & 0xFF));
+                if constexpr (sizeof(U) > 1) {
+                    bits >>= 8;
+                }
+            }
+        }
+    }
+
+    void PutVarint(uint32_t value) {
+        while (value >= 0x80) {
+            out_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void PutBytes(std::string_view bytes) {
+        out_.append(bytes);
+    }
+
+private:
+    std::string& out_;
+};
+
+class Reader {
+public:
+    explicit Reader(std::string_view data)
+        : data_(data) {
+    }
+
+    template <typename T>
+    T GetFixed() {
+        using U = std::conditional_t<sizeof(T) == 8, uint64_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint8_t>>;
+        Require(sizeof(U));
+        U bits = 0;
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(&bits, data_.data() + offset_, sizeof(bits));
+        } else {
+            for (size_t i = 0; i < sizeof(U); ++i) {
+                bits |= static_cast<U>(static_cast<unsigned char>(data_[offset_ + i])) << (8 * i);
+            }
+        }
+        offset_ += sizeof(U);
+        return std::bit_cast<T>(bits);
+    }
+
+    uint32_t GetVarint() {
+        uint32_t value = 0;
+        for (size_t shift = 0; shift < 7 * MAX_VARINT_SIZE; shift += 7) {
+            Require(1);
+            const auto byte = static_cast<unsigned char>(data_[offset_++]);
+            // В пятом байте для uint32 остаются только 4 младших бита
+            if (shift == 7 * (MAX_VARINT_SIZE - 1) && byte > 0x0F) {
+                break;
+            }
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Dog data has a malformed varint");
+    }
+
+    std::string_view GetBytes(size_t size) {
+        Require(size);
+        const auto bytes = data_.substr(offset_, size);
+        offset_ += size;
+        return bytes;
+    }
+
+    size_t GetRemaining() const noexcept {
+        return data_.size() - offset_;
+    }
+
+private:
+    void Require(size_t size) const {
+        if (size > data_.size() - offset_) {
+            throw std::runtime_error("Dog data is truncated");
+        }
+    }
+
+    std::string_view data_;
+    size_t offset_ = 0;
+};
+
+}  // namespace
+
+void EncodeDogs(std::span<const model::DogPtr> dogs, std::string& out) {
+    // Имена интернируются: одинаковые строки записываются один раз
+    std::unordered_map<std::string_view, uint32_t> name_ids;
+    std::vector<std::string_view> names;
+    std::vector<uint32_t> dog_names;
+    dog_names.reserve(dogs.size());
+    size_t names_size = 0;
+    size_t bag_item_count = 0;
+    for (const auto& dog : dogs) {
+        const std::string_view name = dog->GetName();
+        const auto [it, inserted] = name_ids.try_emplace(name, CheckedU32(names.size()));
+        if (inserted) {
+            names.push_back(name);
+            names_size += name.size();
+        }
+        dog_names.push_back(it->second);
+        bag_item_count += dog->GetBagContent().size();
+    }
+
+    out.clear();
+    out.reserve(HEADER_SIZE + names.size() * MAX_VARINT_SIZE + names_size + dogs.size() * DOG_RECORD_SIZE
+                + bag_item_count * 2 * MAX_VARINT_SIZE);
+    Writer writer{out};
+    writer.PutBytes({MAGIC.data(), MAGIC.size()});
+    writer.PutFixed(DOG_CODEC_VERSION);
+    writer.PutFixed(CheckedU32(names.size()));
+    writer.PutFixed(CheckedU32(dogs.size()));
+    writer.PutFixed(CheckedU32(bag_item_count));
+
+    for (const auto name : names) {
+        writer.PutVarint(CheckedU32(name.size()));
+        writer.PutBytes(name);
+    }
+
+    for (size_t i = 0; i < dogs.size(); ++i) {
+        const model::Dog& dog = *dogs[i];
+        writer.PutFixed(*dog.GetId());
+        writer.PutFixed(dog_names[i]);
+        writer.PutFixed(dog.GetPosition().x);
+        writer.PutFixed(dog.GetPosition().y);
+        writer.PutFixed(dog.GetSpeed().x);
+        writer.PutFixed(dog.GetSpeed().y);
+        writer.PutFixed(static_cast<uint32_t>(dog.GetScore()));
+        if (dog.GetBagCapacity() > MAX_BAG_CAPACITY) {
+            throw std::length_error("Dog bag capacity is too large");
+        }
+        writer.PutFixed(static_cast<uint32_t>(dog.GetBagCapacity()));
+        writer.PutFixed(CheckedU32(dog.GetBagContent().size()));
+        writer.PutFixed(static_cast<uint8_t>(dog.GetDirection()));
+        // Выравнивание записи до DOG_RECORD_SIZE
+        writer.PutBytes("\0\0\0"sv);
+    }
+
+    for (const auto& dog : dogs) {
+        for (const auto& item : dog->GetBagContent()) {
+            writer.PutVarint(*item.id);
+            writer.PutVarint(item.type);
+        }
+    }
+}
+
+void DecodeDogs(std::string_view data, DecodedDogs& out) {
+    Reader reader{data};
+    if (reader.GetBytes(MAGIC.size()) != std::string_view{MAGIC.data(), MAGIC.size()}) {
+        throw std::runtime_error("Not a dog codec buffer");
+    }
+    if (const auto version = reader.GetFixed<uint32_t>(); version != DOG_CODEC_VERSION) {
+        throw std::runtime_error("Unsupported dog codec version "s + std::to_string(version));
+    }
+    const auto name_count = reader.GetFixed<uint32_t>();
+    const auto dog_count = reader.GetFixed<uint32_t>();
+    const auto bag_item_count = reader.GetFixed<uint32_t>();
+    // Каждое имя и каждый предмет занимают хотя бы байт, поэтому счётчики можно проверить
+    // до выделения памяти под них
+    if (name_count > reader.GetRemaining() || bag_item_count > reader.GetRemaining()
+        || dog_count > reader.GetRemaining() / DOG_RECORD_SIZE) {
+        throw std::runtime_error("Dog data is truncated");
+    }
+
+    out.name_refs_.clear();
+    out.names_.clear();
+    out.name_refs_.reserve(name_count);
+    for (uint32_t i = 0; i < name_count; ++i) {
+        const auto name = reader.GetBytes(reader.GetVarint());
+        out.name_refs_.push_back({CheckedU32(out.names_.size()), CheckedU32(name.size())});
+        out.names_.append(name);
+    }
+
+    out.records_.clear();
+    out.records_.reserve(dog_count);
+    uint32_t bag_first = 0;
+    for (uint32_t i = 0; i < dog_count; ++i) {
+        DecodedDogs::Record& record = out.records_.emplace_back();
+        record.id = reader.GetFixed<uint32_t>();
+        record.name = reader.GetFixed<uint32_t>();
+        record.pos.x = reader.GetFixed<double>();
+        record.pos.y = reader.GetFixed<double>();
+        record.speed.x = reader.GetFixed<double>();
+        record.speed.y = reader.GetFixed<double>();
+        record.score = reader.GetFixed<uint32_t>();
+        record.bag_capacity = reader.GetFixed<uint32_t>();
+        record.bag_size = reader.GetFixed<uint32_t>();
+        const auto direction = reader.GetFixed<uint8_t>();
+        reader.GetBytes(3);
+
+        if (record.name >= name_count) {
+            throw std::runtime_error("Dog refers to an unknown name");
+        }
+        if (direction > static_cast<uint8_t>(model::Direction::SOUTH)) {
+            throw std::runtime_error("Dog has an invalid direction");
+        }
+        if (record.bag_capacity > MAX_BAG_CAPACITY) {
+            throw std::runtime_error("Dog bag capacity is too large");
+        }
+        if (record.bag_size > record.bag_capacity || record.bag_size > bag_item_count - bag_first) {
+            throw std::runtime_error("Dog bag does not fit");
+        }
+        record.direction = static_cast<model::Direction>(direction);
+        record.bag_first = bag_first;
+        bag_first += record.bag_size;
+    }
+    if (bag_first != bag_item_count) {
+        throw std::runtime_error("Dog bag item count mismatch");
+    }
+
+    out.bag_items_.clear();
+    out.bag_items_.reserve(bag_item_count);
+    for (uint32_t i = 0; i < bag_item_count; ++i) {
+        const auto id = reader.GetVarint();
+        const auto type = reader.GetVarint();
+        out.bag_items_.push_back({model::FoundObject::Id{id}, type});
+    }
+    if (reader.GetRemaining() != 0) {
+        throw std::runtime_error("Dog data has trailing bytes");
+    }
+}
+
+std::string_view DecodedDogs::GetName(size_t index) const {
+    const NameRef& ref = name_refs_[records_[index].name];
+    return std::string_view{names_}.substr(ref.offset, ref.size);
+}
+
+model::Dog DecodedDogs::Restore(size_t index) const {
+    const Record& record = records_[index];
+    model::Dog dog{model::Dog::Id{record.id}, std::string{GetName(index)}, record.pos, record.bag_capacity};
+    dog.SetSpeed(record.speed);
+    dog.SetDirection(record.direction);
+    dog.AddScore(record.score);
+    for (const auto& item : GetBagContent(index)) {
+        // Вместимость проверена при разборе
+        [[maybe_unused]] const bool put = dog.PutToBag(item);
+    }
+    return dog;
+}
+
+std::vector<model::Dog> DecodedDogs::RestoreAll() const {
+    std::vector<model::Dog> dogs;
+    dogs.reserve(records_.size());
+    for (size_t i = 0; i < records_.size(); ++i) {
+        dogs.push_back(Restore(i));
+    }
+    return dogs;
+}
+
+}  // namespace serialization
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "model.h"
+
+namespace serialization {
+
+/*
+ * Компактный двоичный формат состояния собак, замена архивам boost для массового сохранения.
+ * Все числа записываются в порядке little-endian независимо от платформы:
+ *
+ *   заголовок: "DOGC", версия (u32), число имён, собак и предметов в рюкзаках (u32)
+ *   имена:     длина (varint) и байты каждого различного имени
+ *   собаки:    записи фиксированного размера DOG_RECORD_SIZE: id, номер имени, позиция,
+ *              скорость (f64), счёт, вместимость и заполненность рюкзака (u32), направление (u8)
+ *   рюкзаки:   id и тип (varint) каждого предмета, подряд для всех собак по порядку
+ *
+ * Одинаковые имена хранятся один раз. В отличие от архивов boost здесь нет отслеживания
+ * объектов и версий каждого класса - только одна версия формата в заголовке.
+ */
+class DecodedDogs;
+
+inline constexpr uint32_t DOG_CODEC_VERSION = 1;
+inline constexpr size_t DOG_RECORD_SIZE = 56;
+// Рюкзак собаки резервируется на всю вместимость, поэтому она ограничена и при записи, и при разборе
+inline constexpr uint32_t MAX_BAG_CAPACITY = 1024;
+
+// Кодирует dogs в out. Прежнее содержимое out заменяется, его память переиспользуется
+// Бросает std::length_error, если вместимость рюкзака больше MAX_BAG_CAPACITY
+void EncodeDogs(std::span<const model::DogPtr> dogs, std::string& out);
+
+// Разбирает data в out. Буферы out переиспользуются, поэтому повторный разбор в тот же
+// объект не выделяет память. При повреждённых данных, в том числе при вместимости рюкзака
+// больше MAX_BAG_CAPACITY, бросает std::runtime_error
+void DecodeDogs(std::string_view data, DecodedDogs& out);
+
+// Разобранные собаки в плоских массивах: записи, общий массив предметов и общий блок имён
+class DecodedDogs {
+public:
+    size_t GetCount() const noexcept {
+        return records_.size();
+    }
+
+    model::Dog::Id GetId(size_t index) const {
+        return model::Dog::Id{records_[index].id};
+    }
+
+    std::string_view GetName(size_t index) const;
+
+    std::span<const model::FoundObject> GetBagContent(size_t index) const {
+        const Record& record = records_[index];
+        return std::span{bag_items_}.subspan(record.bag_first, record.bag_size);
+    }
+
+    // Собирает index-ю собаку
+    model::Dog Restore(size_t index) const;
+    std::vector<model::Dog> RestoreAll() const;
+
+private:
+    friend void DecodeDogs(std::string_view data, DecodedDogs& out);
+
+    struct Record {
+        uint32_t id;
+        uint32_t name;
+        geom::Point2D pos;
+        geom::Vec2D speed;
+        model::Score score;
+        uint32_t bag_capacity;
+        uint32_t bag_first;
+        uint32_t bag_size;
+        model::Direction direction;
+    };
+
+    struct NameRef {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    std::vector<Record> records_;
+    std::vector<model::FoundObject> bag_items_;
+    std::vector<NameRef> name_refs_;
+    std::string names_;
+};
+
+}  // namespace serialization
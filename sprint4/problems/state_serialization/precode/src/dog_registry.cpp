@@ -0,0 +1,181 @@
+#include "dog_registry.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace model {
+
+namespace {
+
+constexpr uint32_t FREE_SLOT = std::numeric_limits<uint32_t>::max();
+
+// Переносит последний элемент на место index и укорачивает массив
+template <typename T>
+void SwapRemove(std::vector<T>& values, size_t index) {
+    if (index + 1 != values.size()) {
+        values[index] = std::move(values.back());
+    }
+    values.pop_back();
+}
+
+// Освобождает место ещё под extra элементов. Ёмкость растёт геометрически, как при push_back,
+// чтобы добавления по одному не перевыделяли массив каждый раз
+template <typename T>
+void ReserveExtra(std::vector<T>& values, size_t extra) {
+    const size_t size = values.size() + extra;
+    if (size > values.capacity()) {
+        values.reserve(std::max(size, values.capacity() * 2));
+    }
+}
+
+}  // namespace
+
+DogRegistry::DogRegistry(size_t bag_capacity)
+    : bag_capacity_(bag_capacity) {
+}
+
+void DogRegistry::Reserve(size_t count) {
+    x_.reserve(count);
+    y_.reserve(count);
+    speed_x_.reserve(count);
+    speed_y_.reserve(count);
+    directions_.reserve(count);
+    ids_.reserve(count);
+    names_.reserve(count);
+    scores_.reserve(count);
+    bag_sizes_.reserve(count);
+    bags_.reserve(count * bag_capacity_);
+    index_to_slot_.reserve(count);
+    slot_to_index_.reserve(count);
+    slot_generations_.reserve(count);
+}
+
+DogRegistry::Handle DogRegistry::Add(Dog::Id id, std::string name, geom::Point2D pos) {
+    if (GetCount() >= FREE_SLOT) {
+        throw std::length_error("Too many dogs");
+    }
+    // Сначала место во всех столбцах: дальше ничего не бросает, и если памяти не хватило,
+    // реестр остаётся прежним, а не с разной длиной столбцов
+    ReserveExtra(x_, 1);
+    ReserveExtra(y_, 1);
+    ReserveExtra(speed_x_, 1);
+    ReserveExtra(speed_y_, 1);
+    ReserveExtra(directions_, 1);
+    ReserveExtra(ids_, 1);
+    ReserveExtra(names_, 1);
+    ReserveExtra(scores_, 1);
+    ReserveExtra(bag_sizes_, 1);
+    ReserveExtra(bags_, bag_capacity_);
+    ReserveExtra(index_to_slot_, 1);
+    if (free_slots_.empty()) {
+        ReserveExtra(slot_to_index_, 1);
+        ReserveExtra(slot_generations_, 1);
+    }
+
+    const auto index = static_cast<uint32_t>(GetCount());
+    uint32_t slot = 0;
+    if (free_slots_.empty()) {
+        slot = static_cast<uint32_t>(slot_to_index_.size());
+        slot_to_index_.push_back(index);
+        slot_generations_.push_back(0);
+    } else {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        slot_to_index_[slot] = index;
+    }
+
+    x_.push_back(pos.x);
+    y_.push_back(pos.y);
+    speed_x_.push_back(0);
+    speed_y_.push_back(0);
+    directions_.push_back(Direction::NORTH);
+    ids_.push_back(std::move(id));
+    names_.push_back(std::move(name));
+    scores_.push_back(0);
+    bag_sizes_.push_back(0);
+    bags_.resize(bags_.size() + bag_capacity_);
+    index_to_slot_.push_back(slot);
+    return {slot, slot_generations_[slot]};
+}
+
+DogRegistry::Handle DogRegistry::Add(const Dog& dog) {
+    if (dog.GetBagCapacity() != bag_capacity_) {
+        throw std::invalid_argument("Dog bag capacity does not match the registry");
+    }
+    const Handle handle = Add(dog.GetId(), dog.GetName(), dog.GetPosition());
+    const size_t index = GetCount() - 1;
+    SetSpeed(index, dog.GetSpeed());
+    SetDirection(index, dog.GetDirection());
+    AddScore(index, dog.GetScore());
+    for (const auto& item : dog.GetBagContent()) {
+        [[maybe_unused]] const bool put = PutToBag(index, item);
+    }
+    return handle;
+}
+
+void DogRegistry::Remove(Handle handle) {
+    const size_t index = GetIndex(handle);
+    const size_t last = GetCount() - 1;
+
+    if (index != last) {
+        // Рюкзак последней собаки переезжает на место удалённой вместе с остальными полями
+        std::copy_n(bags_.begin() + static_cast<std::ptrdiff_t>(last * bag_capacity_), bag_capacity_,
+                    bags_.begin() + static_cast<std::ptrdiff_t>(index * bag_capacity_));
+        slot_to_index_[index_to_slot_[last]] = static_cast<uint32_t>(index);
+    }
+    bags_.resize(last * bag_capacity_);
+    SwapRemove(x_, index);
+    SwapRemove(y_, index);
+    SwapRemove(speed_x_, index);
+    SwapRemove(speed_y_, index);
+    SwapRemove(directions_, index);
+    SwapRemove(ids_, index);
+    SwapRemove(names_, index);
+    SwapRemove(scores_, index);
+    SwapRemove(bag_sizes_, index);
+    SwapRemove(index_to_slot_, index);
+
+    slot_to_index_[handle.slot] = FREE_SLOT;
+    ++slot_generations_[handle.slot];
+    free_slots_.push_back(handle.slot);
+}
+
+bool DogRegistry::IsValid(Handle handle) const noexcept {
+    return handle.slot < slot_to_index_.size() && slot_to_index_[handle.slot] != FREE_SLOT
+        && slot_generations_[handle.slot] == handle.generation;
+}
+
+size_t DogRegistry::GetIndex(Handle handle) const {
+    if (!IsValid(handle)) {
+        throw std::invalid_argument("Invalid dog handle");
+    }
+    return slot_to_index_[handle.slot];
+}
+
+bool DogRegistry::PutToBag(size_t index, FoundObject item) noexcept {
+    if (IsBagFull(index)) {
+        return false;
+    }
+    bags_[index * bag_capacity_ + bag_sizes_[index]] = item;
+    ++bag_sizes_[index];
+    return true;
+}
+
+size_t DogRegistry::EmptyBag(size_t index) noexcept {
+    return std::exchange(bag_sizes_[index], 0);
+}
+
+Dog DogRegistry::MakeDog(size_t index) const {
+    Dog dog{GetId(index), GetName(index), GetPosition(index), bag_capacity_};
+    dog.SetSpeed(GetSpeed(index));
+    dog.SetDirection(GetDirection(index));
+    dog.AddScore(GetScore(index));
+    for (const auto& item : GetBagContent(index)) {
+        [[maybe_unused]] const bool put = dog.PutToBag(item);
+    }
+    return dog;
+}
+
+}  // namespace model
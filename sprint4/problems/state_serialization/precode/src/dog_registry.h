@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "model.h"
+
+namespace model {
+
+/*
+ * Хранилище собак для обхода в каждом тике.
+ * Вместо отдельного объекта Dog в куче на каждую собаку поля лежат в плотных массивах:
+ * горячие (позиция, скорость, направление) отдельно от холодных (id, имя, счёт, рюкзак).
+ * Рюкзаки всех собак - один общий массив, по bag_capacity мест на собаку.
+ * Собаки занимают индексы [0, GetCount()) без пропусков: при удалении на место удалённой
+ * переносится последняя. Поэтому индекс собаки может меняться, а постоянная ссылка на неё -
+ * Handle. Handle удалённой собаки становится недействительным и больше не совпадёт с другой.
+ */
+class DogRegistry {
+public:
+    struct Handle {
+        uint32_t slot = 0;
+        uint32_t generation = 0;
+
+        auto operator<=>(const Handle&) const = default;
+    };
+
+    // Столбцы координат и скоростей для пакетной обработки. Все массивы длины GetCount()
+    struct MovementColumns {
+        std::span<double> x;
+        std::span<double> y;
+        std::span<double> speed_x;
+        std::span<double> speed_y;
+    };
+
+    explicit DogRegistry(size_t bag_capacity);
+
+    void Reserve(size_t count);
+
+    // Добавляет собаку в конец столбцов. Если бросает исключение, реестр не меняется
+    Handle Add(Dog::Id id, std::string name, geom::Point2D pos);
+    // Переносит собаку в хранилище. Вместимость её рюкзака должна совпадать с bag_capacity
+    Handle Add(const Dog& dog);
+    void Remove(Handle handle);
+
+    bool IsValid(Handle handle) const noexcept;
+    // Индекс собаки. Для недействительного handle бросает std::invalid_argument
+    size_t GetIndex(Handle handle) const;
+    Handle GetHandle(size_t index) const noexcept {
+        return {index_to_slot_[index], slot_generations_[index_to_slot_[index]]};
+    }
+
+    size_t GetCount() const noexcept {
+        return ids_.size();
+    }
+
+    size_t GetBagCapacity() const noexcept {
+        return bag_capacity_;
+    }
+
+    // Горячие поля
+    geom::Point2D GetPosition(size_t index) const noexcept {
+        return {x_[index], y_[index]};
+    }
+    void SetPosition(size_t index, geom::Point2D pos) noexcept {
+        x_[index] = pos.x;
+        y_[index] = pos.y;
+    }
+    geom::Vec2D GetSpeed(size_t index) const noexcept {
+        return {speed_x_[index], speed_y_[index]};
+    }
+    void SetSpeed(size_t index, geom::Vec2D speed) noexcept {
+        speed_x_[index] = speed.x;
+        speed_y_[index] = speed.y;
+    }
+    Direction GetDirection(size_t index) const noexcept {
+        return directions_[index];
+    }
+    void SetDirection(size_t index, Direction direction) noexcept {
+        directions_[index] = direction;
+    }
+
+    MovementColumns GetMovementColumns() noexcept {
+        return {x_, y_, speed_x_, speed_y_};
+    }
+
+    // Холодные поля
+    const Dog::Id& GetId(size_t index) const noexcept {
+        return ids_[index];
+    }
+    const std::string& GetName(size_t index) const noexcept {
+        return names_[index];
+    }
+    Score GetScore(size_t index) const noexcept {
+        return scores_[index];
+    }
+    void AddScore(size_t index, Score score) noexcept {
+        scores_[index] += score;
+    }
+
+    std::span<const FoundObject> GetBagContent(size_t index) const noexcept {
+        return std::span{bags_}.subspan(index * bag_capacity_, bag_sizes_[index]);
+    }
+    bool IsBagFull(size_t index) const noexcept {
+        return bag_sizes_[index] >= bag_capacity_;
+    }
+    [[nodiscard]] bool PutToBag(size_t index, FoundObject item) noexcept;
+    size_t EmptyBag(size_t index) noexcept;
+
+    // Собирает обычный Dog, например для сериализации
+    Dog MakeDog(size_t index) const;
+
+private:
+    size_t bag_capacity_;
+
+    // Плотные массивы, по элементу на собаку
+    std::vector<double> x_;
+    std::vector<double> y_;
+    std::vector<double> speed_x_;
+    std::vector<double> speed_y_;
+    std::vector<Direction> directions_;
+    std::vector<Dog::Id> ids_;
+    std::vector<std::string> names_;
+    std::vector<Score> scores_;
+    std::vector<uint32_t> bag_sizes_;
+    std::vector<FoundObject> bags_;
+    std::vector<uint32_t> index_to_slot_;
+
+    // Таблица слотов: индекс собаки и поколение слота. Свободные слоты переиспользуются
+    std::vector<uint32_t> slot_to_index_;
+    std::vector<uint32_t> slot_generations_;
+    std::vector<uint32_t> free_slots_;
+};
+
+}  // namespace model
@@ -0,0 +1,80 @@
+#include "file_util.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+
+namespace serialization {
+using namespace std::literals;
+
+namespace {
+
+// Закрывает fd и бросает исключение с кодом ошибки, которую вернул предыдущий вызов. errno
+// сохраняется до close, иначе её код может затереть ошибка самого close
+[[noreturn]] void CloseAndThrow(int fd, const std::string& what) {
+    const int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), what);
+}
+
+// Пишет data в fd целиком и делает fsync. Закрывает fd в любом случае
+void WriteAndSync(int fd, const std::filesystem::path& path, std::string_view data) {
+    for (size_t written = 0; written < data.size();) {
+        const ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            CloseAndThrow(fd, "Could not write "s + path.string());
+        }
+        written += static_cast<size_t>(result);
+    }
+    if (::fsync(fd) != 0) {
+        CloseAndThrow(fd, "Could not sync "s + path.string());
+    }
+    ::close(fd);
+}
+
+}  // namespace
+
+void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void SyncDirectory(const std::filesystem::path& dir) {
+    const int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowSystemError("Could not open "s + dir.string());
+    }
+    if (::fsync(fd) != 0) {
+        CloseAndThrow(fd, "Could not sync "s + dir.string());
+    }
+    ::close(fd);
+}
+
+void WriteFileAtomically(const std::filesystem::path& path, std::string_view data) {
+    auto temp_path = path;
+    temp_path += ".tmp"sv;
+
+    const int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ThrowSystemError("Could not create "s + temp_path.string());
+    }
+    WriteAndSync(fd, temp_path, data);
+
+    std::filesystem::rename(temp_path, path);
+    // Без этого после сбоя питания переименование может не сохраниться
+    SyncDirectory(path.parent_path());
+}
+
+void AppendToFile(const std::filesystem::path& path, std::string_view data) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowSystemError("Could not open "s + path.string());
+    }
+    WriteAndSync(fd, path, data);
+}
+
+}  // namespace serialization
@@ -0,0 +1,22 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace serialization {
+
+// Бросает std::system_error с текущим errno
+[[noreturn]] void ThrowSystemError(const std::string& what);
+
+// Сбрасывает на диск записи каталога, например после создания или переименования файла в нём
+void SyncDirectory(const std::filesystem::path& dir);
+
+// Пишет data во временный файл, сбрасывает его на диск и атомарно заменяет им path.
+// После сбоя под именем path лежит либо старое содержимое, либо новое целиком
+void WriteFileAtomically(const std::filesystem::path& path, std::string_view data);
+
+// Дописывает data в конец существующего файла и сбрасывает его на диск. При ошибке в конце
+// файла может остаться часть data
+void AppendToFile(const std::filesystem::path& path, std::string_view data);
+
+}  // namespace serialization
@@ -1,3 +1,4 @@
+#pragma once
 #include <boost/serialization/vector.hpp>
 
 #include "model.h"
@@ -46,6 +47,19 @@ public:
         , bag_content_(dog.GetBagContent()) {
     }
 
+    // Перезаписывает представление состоянием dog. Память под имя и рюкзак переиспользуется,
+    // поэтому повторное обновление того же DogRepr обычно обходится без выделений
+    void Update(const model::Dog& dog) {
+        id_ = dog.GetId();
+        name_ = dog.GetName();
+        pos_ = dog.GetPosition();
+        bag_capacity_ = dog.GetBagCapacity();
+        speed_ = dog.GetSpeed();
+        direction_ = dog.GetDirection();
+        score_ = dog.GetScore();
+        bag_content_ = dog.GetBagContent();
+    }
+
     [[nodiscard]] model::Dog Restore() const {
         model::Dog dog{id_, name_, pos_, bag_capacity_};
         dog.SetSpeed(speed_);
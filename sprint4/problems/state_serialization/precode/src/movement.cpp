@@ -0,0 +1,112 @@
+#include "movement.h"
+
+#include <cassert>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MOVEMENT_HAS_AVX2_KERNEL 1
+#endif
+
+namespace model {
+
+namespace {
+
+void AssertSameSizes([[maybe_unused]] const DogRegistry::MovementColumns& dogs,
+                     [[maybe_unused]] const MovementBounds& bounds) {
+    assert(dogs.y.size() == dogs.x.size() && dogs.speed_x.size() == dogs.x.size()
+           && dogs.speed_y.size() == dogs.x.size());
+    assert(bounds.min_x.size() == dogs.x.size() && bounds.min_y.size() == dogs.x.size()
+           && bounds.max_x.size() == dogs.x.size() && bounds.max_y.size() == dogs.x.size());
+}
+
+// Сравнения записаны так же, как работают _mm256_max_pd и _mm256_min_pd, чтобы скалярный
+// и векторный код давали одинаковый результат и для NaN
+double Clamp(double value, double min, double max) {
+    const double at_least_min = value > min ? value : min;
+    return at_least_min < max ? at_least_min : max;
+}
+
+void MoveOne(const DogRegistry::MovementColumns& dogs, const MovementBounds& bounds, double dt, size_t i) {
+    const double new_x = dogs.x[i] + dogs.speed_x[i] * dt;
+    const double new_y = dogs.y[i] + dogs.speed_y[i] * dt;
+    const double x = Clamp(new_x, bounds.min_x[i], bounds.max_x[i]);
+    const double y = Clamp(new_y, bounds.min_y[i], bounds.max_y[i]);
+    dogs.x[i] = x;
+    dogs.y[i] = y;
+    if (x != new_x || y != new_y) {
+        dogs.speed_x[i] = 0;
+        dogs.speed_y[i] = 0;
+    }
+}
+
+}  // namespace
+
+namespace detail {
+
+void IntegrateMovementScalar(const DogRegistry::MovementColumns& dogs, const MovementBounds& bounds, double dt) {
+    AssertSameSizes(dogs, bounds);
+    for (size_t i = 0; i < dogs.x.size(); ++i) {
+        MoveOne(dogs, bounds, dt, i);
+    }
+}
+
+#ifdef MOVEMENT_HAS_AVX2_KERNEL
+
+// По четыре собаки за итерацию. Умножение и сложение раздельные, без FMA, как в скалярном коде
+__attribute__((target("avx2")))
+void IntegrateMovementAvx2(const DogRegistry::MovementColumns& dogs, const MovementBounds& bounds, double dt) {
+    AssertSameSizes(dogs, bounds);
+    const __m256d dt4 = _mm256_set1_pd(dt);
+    const __m256d zero = _mm256_setzero_pd();
+
+    const size_t count = dogs.x.size();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d speed_x = _mm256_loadu_pd(dogs.speed_x.data() + i);
+        const __m256d speed_y = _mm256_loadu_pd(dogs.speed_y.data() + i);
+        const __m256d new_x = _mm256_add_pd(_mm256_loadu_pd(dogs.x.data() + i), _mm256_mul_pd(speed_x, dt4));
+        const __m256d new_y = _mm256_add_pd(_mm256_loadu_pd(dogs.y.data() + i), _mm256_mul_pd(speed_y, dt4));
+        const __m256d x = _mm256_min_pd(_mm256_max_pd(new_x, _mm256_loadu_pd(bounds.min_x.data() + i)),
+                                        _mm256_loadu_pd(bounds.max_x.data() + i));
+        const __m256d y = _mm256_min_pd(_mm256_max_pd(new_y, _mm256_loadu_pd(bounds.min_y.data() + i)),
+                                        _mm256_loadu_pd(bounds.max_y.data() + i));
+        _mm256_storeu_pd(dogs.x.data() + i, x);
+        _mm256_storeu_pd(dogs.y.data() + i, y);
+
+        const __m256d stopped = _mm256_or_pd(_mm256_cmp_pd(x, new_x, _CMP_NEQ_UQ), _mm256_cmp_pd(y, new_y, _CMP_NEQ_UQ));
+        _mm256_storeu_pd(dogs.speed_x.data() + i, _mm256_blendv_pd(speed_x, zero, stopped));
+        _mm256_storeu_pd(dogs.speed_y.data() + i, _mm256_blendv_pd(speed_y, zero, stopped));
+    }
+    for (; i < count; ++i) {
+        MoveOne(dogs, bounds, dt, i);
+    }
+}
+
+bool HasAvx2() {
+    static const bool has_avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return has_avx2;
+}
+
+#else
+
+void IntegrateMovementAvx2(const DogRegistry::MovementColumns& dogs, const MovementBounds& bounds, double dt) {
+    IntegrateMovementScalar(dogs, bounds, dt);
+}
+
+bool HasAvx2() {
+    return false;
+}
+
+#endif
+
+}  // namespace detail
+
+void IntegrateMovement(const DogRegistry::MovementColumns& dogs, const MovementBounds& bounds, double dt) {
+    if (detail::HasAvx2()) {
+        detail::IntegrateMovementAvx2(dogs, bounds, dt);
+    } else {
+        detail::IntegrateMovementScalar(dogs, bounds, dt);
+    }
+}
+
+}  // namespace model
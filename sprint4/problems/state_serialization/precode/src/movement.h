@@ -0,0 +1,33 @@
+#pragma once
+#include <span>
+
+#include "dog_registry.h"
+
+namespace model {
+
+// Границы, в которых может находиться каждая собака (например, дорога, по которой она идёт).
+// i-я собака ограничена прямоугольником [min_x[i], max_x[i]] x [min_y[i], max_y[i]].
+// Все массивы длины DogRegistry::GetCount()
+struct MovementBounds {
+    std::span<const double> min_x;
+    std::span<const double> min_y;
+    std::span<const double> max_x;
+    std::span<const double> max_y;
+};
+
+// Перемещает всех собак за время dt: pos += speed * dt. Собака, вышедшая бы за свои границы,
+// останавливается на границе, и её скорость обнуляется.
+// Использует AVX2, если процессор его поддерживает, иначе - скалярный цикл. Результаты совпадают бит в бит
+void IntegrateMovement(const DogRegistry::MovementColumns& dogs, const MovementBounds& bounds, double dt);
+
+namespace detail {
+
+// Реализации IntegrateMovement, доступные для тестов и замеров
+void IntegrateMovementScalar(const DogRegistry::MovementColumns& dogs, const MovementBounds& bounds, double dt);
+// Вызывать только при HasAvx2() == true
+void IntegrateMovementAvx2(const DogRegistry::MovementColumns& dogs, const MovementBounds& bounds, double dt);
+bool HasAvx2();
+
+}  // namespace detail
+
+}  // namespace model
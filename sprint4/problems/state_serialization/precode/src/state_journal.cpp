@@ -0,0 +1,490 @@
+#include "state_journal.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+
+#include "file_util.h"
+
+namespace serialization {
+using namespace std::literals;
+
+namespace {
+
+constexpr std::array<char, 8> SEGMENT_MAGIC = {'D', 'O', 'G', 'J', 'R', 'N', 'L', '\0'};
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr uint32_t BATCH_MAGIC = 0x48435442;  // "BTCH"
+constexpr auto SEGMENT_EXTENSION = ".journal"sv;
+
+struct SegmentHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// Пакет - заголовок и size байт записей. CRC считается по номеру тика и записям
+struct BatchHeader {
+    uint32_t magic;
+    uint32_t size;
+    uint64_t tick;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+// Запись: вид (u8), id собаки (u32) и данные, зависящие от вида
+enum RecordKind : uint8_t {
+    NEW_DOG = 1,  // позиция (2 x f64), вместимость рюкзака (u64), длина имени (u32), имя
+    POSITION,     // 2 x f64
+    SPEED,        // 2 x f64
+    DIRECTION,    // u8
+    BAG_PUT,      // id и тип предмета (2 x u32)
+    BAG_EMPTY,    // без данных
+    SCORE,        // итоговый счёт (u32)
+};
+
+uint32_t BatchChecksum(uint64_t tick, std::string_view records) {
+    boost::crc_32_type crc;
+    crc.process_bytes(&tick, sizeof(tick));
+    crc.process_bytes(records.data(), records.size());
+    return crc.checksum();
+}
+
+std::filesystem::path SegmentPath(const std::filesystem::path& dir, uint64_t sequence) {
+    auto name = std::to_string(sequence);
+    if (name.size() < 6) {
+        name.insert(0, 6 - name.size(), '0');
+    }
+    return dir / (name + std::string{SEGMENT_EXTENSION});
+}
+
+// Номера и пути сегментов каталога по возрастанию номера
+std::vector<std::pair<uint64_t, std::filesystem::path>> ListSegments(const std::filesystem::path& dir) {
+    std::vector<std::pair<uint64_t, std::filesystem::path>> segments;
+    if (!std::filesystem::exists(dir)) {
+        return segments;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator{dir}) {
+        const auto& path = entry.path();
+        if (!entry.is_regular_file() || path.extension() != SEGMENT_EXTENSION) {
+            continue;
+        }
+        const std::string stem = path.stem().string();
+        uint64_t sequence = 0;
+        const auto [end, ec] = std::from_chars(stem.data(), stem.data() + stem.size(), sequence);
+        if (ec == std::errc{} && end == stem.data() + stem.size()) {
+            segments.emplace_back(sequence, path);
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+// Итог чтения сегмента
+struct SegmentScan {
+    // Размер заголовка и целых пакетов в начале сегмента
+    size_t valid_size = 0;
+    // false - за целыми пакетами идёт недописанный или повреждённый
+    bool intact = true;
+};
+
+// Вызывает fn(tick, records) для каждого целого пакета сегмента до первого недописанного или повреждённого
+template <typename Fn>
+SegmentScan ForEachBatch(const std::filesystem::path& path, Fn&& fn) {
+    std::ifstream in(path, std::ios::binary);
+    const std::string data{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+
+    SegmentHeader header{};
+    // Сбой между созданием сегмента и записью заголовка оставляет файл из нулей - это пустой сегмент
+    if (data.size() < sizeof(header) || std::all_of(data.begin(), data.begin() + sizeof(header), [](char c) {
+            return c == '\0';
+        })) {
+        return {};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != SEGMENT_MAGIC) {
+        throw std::runtime_error("Not a journal segment: "s + path.string());
+    }
+    if (header.version != FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported journal version "s + std::to_string(header.version));
+    }
+
+    size_t offset = sizeof(header);
+    while (offset < data.size()) {
+        const size_t available = data.size() - offset;
+        BatchHeader batch{};
+        std::memcpy(&batch, data.data() + offset, std::min(sizeof(batch), available));
+        // Заголовок пакета пишется последним, поэтому нулевой заголовок - конец записанного.
+        // Такой хвост остаётся в сегменте, который не успели закрыть
+        if (batch.magic == 0) {
+            break;
+        }
+        if (batch.magic != BATCH_MAGIC || available < sizeof(batch) || batch.size > available - sizeof(batch)) {
+            return {offset, false};
+        }
+        const std::string_view records{data.data() + offset + sizeof(batch), batch.size};
+        if (BatchChecksum(batch.tick, records) != batch.crc) {
+            return {offset, false};
+        }
+        fn(batch.tick, records);
+        offset += sizeof(batch) + batch.size;
+    }
+    return {offset, true};
+}
+
+// Обрезает сегмент до size байт и сбрасывает его на диск
+void TruncateSegment(const std::filesystem::path& path, size_t size) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowSystemError("Could not open "s + path.string());
+    }
+    const bool ok = ::ftruncate(fd, static_cast<off_t>(size)) == 0 && ::fsync(fd) == 0;
+    const int error = errno;
+    ::close(fd);
+    if (!ok) {
+        throw std::system_error(error, std::generic_category(), "Could not truncate "s + path.string());
+    }
+}
+
+class RecordReader {
+public:
+    explicit RecordReader(std::string_view data)
+        : data_(data) {
+    }
+
+    bool AtEnd() const noexcept {
+        return data_.empty();
+    }
+
+    template <typename T>
+    T Get() {
+        T value;
+        std::memcpy(&value, GetBytes(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    std::string_view GetBytes(size_t size) {
+        if (size > data_.size()) {
+            throw std::runtime_error("Journal record is truncated");
+        }
+        const auto bytes = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return bytes;
+    }
+
+private:
+    std::string_view data_;
+};
+
+void ApplyRecords(std::string_view records, std::vector<model::Dog>& dogs,
+                  std::unordered_map<uint32_t, size_t>& dog_index) {
+    RecordReader reader{records};
+    while (!reader.AtEnd()) {
+        const auto kind = reader.Get<uint8_t>();
+        const auto id = reader.Get<uint32_t>();
+
+        if (kind == NEW_DOG) {
+            const auto x = reader.Get<double>();
+            const auto y = reader.Get<double>();
+            const auto bag_capacity = reader.Get<uint64_t>();
+            const auto name = reader.GetBytes(reader.Get<uint32_t>());
+            model::Dog dog{model::Dog::Id{id}, std::string{name}, {x, y}, bag_capacity};
+            if (const auto it = dog_index.find(id); it != dog_index.end()) {
+                dogs[it->second] = std::move(dog);
+            } else {
+                dog_index.emplace(id, dogs.size());
+                dogs.push_back(std::move(dog));
+            }
+            continue;
+        }
+
+        const auto it = dog_index.find(id);
+        if (it == dog_index.end()) {
+            throw std::runtime_error("Journal refers to unknown dog "s + std::to_string(id));
+        }
+        model::Dog& dog = dogs[it->second];
+        switch (kind) {
+            case POSITION: {
+                const auto x = reader.Get<double>();
+                dog.SetPosition({x, reader.Get<double>()});
+                break;
+            }
+            case SPEED: {
+                const auto x = reader.Get<double>();
+                dog.SetSpeed({x, reader.Get<double>()});
+                break;
+            }
+            case DIRECTION:
+                dog.SetDirection(static_cast<model::Direction>(reader.Get<uint8_t>()));
+                break;
+            case BAG_PUT: {
+                const auto item_id = reader.Get<uint32_t>();
+                const auto type = reader.Get<uint32_t>();
+                if (!dog.PutToBag({model::FoundObject::Id{item_id}, type})) {
+                    throw std::runtime_error("Failed to put bag content");
+                }
+                break;
+            }
+            case BAG_EMPTY:
+                dog.EmptyBag();
+                break;
+            case SCORE:
+                dog.AddScore(reader.Get<uint32_t>() - dog.GetScore());
+                break;
+            default:
+                throw std::runtime_error("Unknown journal record kind");
+        }
+    }
+}
+
+}  // namespace
+
+StateJournal::StateJournal(std::filesystem::path dir, size_t segment_size)
+    : dir_(std::move(dir))
+    , segment_size_(std::max(segment_size, sizeof(SegmentHeader) + sizeof(BatchHeader))) {
+    std::filesystem::create_directories(dir_);
+    // Сегменты прошлых запусков остаются до ReleaseUpTo, новые пишутся после них.
+    // ReplayJournal останавливается на первом повреждённом пакете, и всё, что после него, отбрасывается:
+    // иначе пакеты этого запуска оказались бы за повреждением и тоже не восстановились бы
+    bool damaged = false;
+    for (const auto& [sequence, path] : ListSegments(dir_)) {
+        next_sequence_ = sequence + 1;
+        if (damaged) {
+            std::filesystem::remove(path);
+            continue;
+        }
+        uint64_t last_tick = 0;
+        const auto scan = ForEachBatch(path, [&last_tick](uint64_t tick, std::string_view) {
+            last_tick = tick;
+        });
+        if (!scan.intact) {
+            TruncateSegment(path, scan.valid_size);
+            damaged = true;
+        }
+        closed_.push_back({path, last_tick});
+    }
+    batch_.reserve(64 * 1024);
+    OpenSegment(0);
+}
+
+StateJournal::~StateJournal() {
+    try {
+        CloseSegment(true);
+    } catch (...) {
+    }
+}
+
+template <typename T>
+void StateJournal::Append(const T& value) {
+    batch_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void StateJournal::BeginRecord(uint8_t kind, const model::Dog& dog) {
+    Append(kind);
+    Append(*dog.GetId());
+}
+
+void StateJournal::AddDog(const model::Dog& dog) {
+    BeginRecord(NEW_DOG, dog);
+    Append(dog.GetPosition().x);
+    Append(dog.GetPosition().y);
+    Append(static_cast<uint64_t>(dog.GetBagCapacity()));
+    Append(static_cast<uint32_t>(dog.GetName().size()));
+    batch_.append(dog.GetName());
+
+    // Остальное состояние - обычными записями, если оно отличается от начального
+    if (dog.GetSpeed() != geom::Vec2D{}) {
+        BeginRecord(SPEED, dog);
+        Append(dog.GetSpeed().x);
+        Append(dog.GetSpeed().y);
+    }
+    if (dog.GetDirection() != model::Direction::NORTH) {
+        BeginRecord(DIRECTION, dog);
+        Append(static_cast<uint8_t>(dog.GetDirection()));
+    }
+    if (dog.GetScore() != 0) {
+        BeginRecord(SCORE, dog);
+        Append(static_cast<uint32_t>(dog.GetScore()));
+    }
+    for (const auto& item : dog.GetBagContent()) {
+        BeginRecord(BAG_PUT, dog);
+        Append(*item.id);
+        Append(item.type);
+    }
+}
+
+void StateJournal::SetPosition(model::Dog& dog, geom::Point2D position) {
+    dog.SetPosition(position);
+    BeginRecord(POSITION, dog);
+    Append(position.x);
+    Append(position.y);
+}
+
+void StateJournal::SetSpeed(model::Dog& dog, geom::Vec2D speed) {
+    dog.SetSpeed(speed);
+    BeginRecord(SPEED, dog);
+    Append(speed.x);
+    Append(speed.y);
+}
+
+void StateJournal::SetDirection(model::Dog& dog, model::Direction direction) {
+    dog.SetDirection(direction);
+    BeginRecord(DIRECTION, dog);
+    Append(static_cast<uint8_t>(direction));
+}
+
+bool StateJournal::PutToBag(model::Dog& dog, model::FoundObject item) {
+    if (!dog.PutToBag(item)) {
+        return false;
+    }
+    BeginRecord(BAG_PUT, dog);
+    Append(*item.id);
+    Append(item.type);
+    return true;
+}
+
+size_t StateJournal::EmptyBag(model::Dog& dog) {
+    BeginRecord(BAG_EMPTY, dog);
+    return dog.EmptyBag();
+}
+
+void StateJournal::AddScore(model::Dog& dog, model::Score score) {
+    dog.AddScore(score);
+    // Пишется итоговый счёт, а не прибавка: повторное применение записи ничего не портит
+    BeginRecord(SCORE, dog);
+    Append(static_cast<uint32_t>(dog.GetScore()));
+}
+
+void StateJournal::CommitTick(uint64_t tick) {
+    if (batch_.empty()) {
+        return;
+    }
+    const size_t size = sizeof(BatchHeader) + batch_.size();
+    if (size > segment_.capacity - segment_.used) {
+        CloseSegment(true);
+        OpenSegment(size);
+    }
+
+    // Сначала записи, потом заголовок: пакет без заголовка при чтении не виден
+    char* const destination = segment_.data + segment_.used;
+    std::memcpy(destination + sizeof(BatchHeader), batch_.data(), batch_.size());
+    const BatchHeader header{BATCH_MAGIC, static_cast<uint32_t>(batch_.size()), tick, BatchChecksum(tick, batch_), 0};
+    std::memcpy(destination, &header, sizeof(header));
+
+    segment_.used += size;
+    segment_.last_tick = tick;
+    batch_.clear();
+}
+
+void StateJournal::Sync() {
+    if (::msync(segment_.data, segment_.used, MS_SYNC) != 0) {
+        ThrowSystemError("Could not sync "s + segment_.path.string());
+    }
+}
+
+void StateJournal::ReleaseUpTo(uint64_t tick) {
+    std::erase_if(closed_, [tick](const ClosedSegment& segment) {
+        if (segment.last_tick > tick) {
+            return false;
+        }
+        std::filesystem::remove(segment.path);
+        return true;
+    });
+    if (segment_.used > sizeof(SegmentHeader) && segment_.last_tick <= tick) {
+        const auto path = segment_.path;
+        CloseSegment(false);
+        closed_.pop_back();
+        std::filesystem::remove(path);
+        OpenSegment(0);
+    }
+}
+
+void StateJournal::OpenSegment(size_t min_capacity) {
+    Segment segment;
+    segment.path = SegmentPath(dir_, next_sequence_++);
+    segment.capacity = std::max(segment_size_, sizeof(SegmentHeader) + min_capacity);
+
+    segment.fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment.fd < 0) {
+        ThrowSystemError("Could not create "s + segment.path.string());
+    }
+    // Место выделяется сразу, чтобы запись в отображение не упала с SIGBUS на переполненном диске
+    if (const int error = ::posix_fallocate(segment.fd, 0, static_cast<off_t>(segment.capacity)); error != 0) {
+        ::close(segment.fd);
+        throw std::system_error(error, std::generic_category(), "Could not allocate "s + segment.path.string());
+    }
+    void* data = ::mmap(nullptr, segment.capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(segment.fd);
+        ThrowSystemError("Could not map "s + segment.path.string());
+    }
+    segment.data = static_cast<char*>(data);
+
+    const SegmentHeader header{SEGMENT_MAGIC, FORMAT_VERSION, 0};
+    std::memcpy(segment.data, &header, sizeof(header));
+    segment.used = sizeof(header);
+    segment_ = std::move(segment);
+    // Имя нового сегмента должно пережить сбой питания вместе с его содержимым
+    SyncDirectory(dir_);
+}
+
+void StateJournal::CloseSegment(bool sync) {
+    if (segment_.data == nullptr) {
+        return;
+    }
+    ::munmap(segment_.data, segment_.capacity);
+    // Неиспользованный хвост сегмента больше не нужен. fsync сбрасывает и записанные через
+    // отображение страницы, и новый размер
+    std::string failure;
+    int error = 0;
+    if (::ftruncate(segment_.fd, static_cast<off_t>(segment_.used)) != 0) {
+        failure = "Could not truncate "s;
+        error = errno;
+    } else if (sync && ::fsync(segment_.fd) != 0) {
+        failure = "Could not sync "s;
+        error = errno;
+    }
+    ::close(segment_.fd);
+    closed_.push_back({segment_.path, segment_.last_tick});
+    segment_ = Segment{};
+    if (error != 0) {
+        throw std::system_error(error, std::generic_category(), failure + closed_.back().path.string());
+    }
+}
+
+uint64_t ReplayJournal(const std::filesystem::path& dir, uint64_t after_tick, std::vector<model::Dog>& dogs) {
+    std::unordered_map<uint32_t, size_t> dog_index;
+    for (size_t i = 0; i < dogs.size(); ++i) {
+        dog_index.emplace(*dogs[i].GetId(), i);
+    }
+
+    uint64_t last_tick = after_tick;
+    for (const auto& [sequence, path] : ListSegments(dir)) {
+        const auto scan = ForEachBatch(path, [&](uint64_t tick, std::string_view records) {
+            if (tick > after_tick) {
+                ApplyRecords(records, dogs, dog_index);
+                last_tick = std::max(last_tick, tick);
+            }
+        });
+        // Пакеты после потерянного применялись бы к состоянию без его изменений
+        if (!scan.intact) {
+            break;
+        }
+    }
+    return last_tick;
+}
+
+}  // namespace serialization
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "model.h"
+
+namespace serialization {
+
+/*
+ * Журнал изменений собак между сохранениями снимков (write-ahead log).
+ * Изменения собак делаются через методы журнала: они меняют собаку и дописывают запись
+ * в пакет текущего тика, это только копирование в заранее выделенный буфер. CommitTick
+ * копирует пакет с заголовком и CRC-32 в сегмент журнала, отображённый в память (MAP_SHARED),
+ * поэтому записанное переживает падение процесса без системных вызовов на каждое изменение.
+ * От сбоя питания защищает Sync. Заполненный сегмент сбрасывается на диск при переходе к следующему.
+ *
+ * Журнал - каталог сегментов фиксированного размера 000001.journal, 000002.journal, ...
+ * Каждый запуск начинает новый сегмент. Когда сохранён снимок состояния на тик T, сегменты
+ * со старыми пакетами удаляются вызовом ReleaseUpTo(T). Восстановление - загрузка снимка
+ * и ReplayJournal с пакетами новее T. Тик снимка хранится в нём самом (SavedState::tick).
+ * Числа пишутся в порядке байт машины: журнал читается тем же сервером после перезапуска.
+ */
+class StateJournal {
+public:
+    static constexpr size_t DEFAULT_SEGMENT_SIZE = 16 * 1024 * 1024;
+
+    // Открывать журнал нужно после ReplayJournal: если в нём есть повреждённый пакет, этот пакет
+    // и всё после него удаляются
+    explicit StateJournal(std::filesystem::path dir, size_t segment_size = DEFAULT_SEGMENT_SIZE);
+
+    StateJournal(const StateJournal&) = delete;
+    StateJournal& operator=(const StateJournal&) = delete;
+
+    ~StateJournal();
+
+    // Изменения собак с записью в журнал
+    void AddDog(const model::Dog& dog);
+    void SetPosition(model::Dog& dog, geom::Point2D position);
+    void SetSpeed(model::Dog& dog, geom::Vec2D speed);
+    void SetDirection(model::Dog& dog, model::Direction direction);
+    [[nodiscard]] bool PutToBag(model::Dog& dog, model::FoundObject item);
+    size_t EmptyBag(model::Dog& dog);
+    void AddScore(model::Dog& dog, model::Score score);
+
+    // Дописывает изменения, накопленные с прошлого вызова, одним пакетом с номером tick.
+    // Номера тиков должны возрастать
+    void CommitTick(uint64_t tick);
+
+    // Сбрасывает на диск текущий сегмент (msync). Закрытые сегменты уже сброшены при закрытии,
+    // так что после Sync на диске весь записанный журнал
+    void Sync();
+
+    // Удаляет сегменты, в которых нет пакетов новее tick
+    void ReleaseUpTo(uint64_t tick);
+
+private:
+    struct Segment {
+        std::filesystem::path path;
+        int fd = -1;
+        char* data = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+        uint64_t last_tick = 0;
+    };
+
+    struct ClosedSegment {
+        std::filesystem::path path;
+        uint64_t last_tick;
+    };
+
+    template <typename T>
+    void Append(const T& value);
+    void BeginRecord(uint8_t kind, const model::Dog& dog);
+
+    void OpenSegment(size_t min_capacity);
+    // sync - сбросить сегмент на диск. Не нужно, если сегмент сразу удаляется
+    void CloseSegment(bool sync);
+
+    std::filesystem::path dir_;
+    size_t segment_size_;
+    uint64_t next_sequence_ = 1;
+    Segment segment_;
+    std::vector<ClosedSegment> closed_;
+    // Пакет текущего тика
+    std::string batch_;
+};
+
+// Применяет к dogs пакеты журнала из dir с номерами тиков больше after_tick. Собаки, добавленные
+// после снимка, дописываются в конец dogs. Чтение журнала останавливается на первом недописанном
+// или повреждённом пакете, следующие сегменты тоже не применяются. Сегмент из нулей (сбой до записи
+// заголовка) считается пустым. Возвращает номер последнего применённого тика (after_tick, если таких нет)
+uint64_t ReplayJournal(const std::filesystem::path& dir, uint64_t after_tick, std::vector<model::Dog>& dogs);
+
+}  // namespace serialization
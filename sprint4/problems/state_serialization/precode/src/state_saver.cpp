@@ -0,0 +1,176 @@
+#include "state_saver.h"
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/crc.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "file_util.h"
+
+namespace serialization {
+using namespace std::literals;
+
+namespace {
+
+uint32_t Checksum(std::string_view data) {
+    boost::crc_32_type crc;
+    crc.process_bytes(data.data(), data.size());
+    return crc.checksum();
+}
+
+// Архив boost с тиком, числом собак и самими собаками, за ним - CRC-32 архива
+std::string SerializeDogs(uint64_t tick, std::span<const DogRepr> dogs) {
+    std::ostringstream out(std::ios::binary);
+    {
+        boost::archive::binary_oarchive ar{out};
+        const uint64_t count = dogs.size();
+        ar << tick << count;
+        for (const auto& dog : dogs) {
+            ar << dog;
+        }
+    }
+    std::string data = std::move(out).str();
+    const uint32_t checksum = Checksum(data);
+    data.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    return data;
+}
+
+}  // namespace
+
+BackgroundStateSaver::BackgroundStateSaver(std::filesystem::path path, size_t expected_dogs)
+    : path_(std::move(path)) {
+    pending_.reserve(expected_dogs);
+    writing_.reserve(expected_dogs);
+    worker_ = std::jthread([this](std::stop_token stop) {
+        Run(std::move(stop));
+    });
+}
+
+BackgroundStateSaver::~BackgroundStateSaver() {
+    worker_.request_stop();
+    worker_.join();
+}
+
+void BackgroundStateSaver::Capture(std::span<const model::DogPtr> dogs, uint64_t tick) {
+    {
+        std::lock_guard lock{mutex_};
+        if (pending_.size() < dogs.size()) {
+            pending_.resize(dogs.size());
+        }
+        for (size_t i = 0; i < dogs.size(); ++i) {
+            pending_[i].Update(*dogs[i]);
+        }
+        pending_count_ = dogs.size();
+        pending_tick_ = tick;
+        if (has_pending_) {
+            ++dropped_count_;
+        }
+        has_pending_ = true;
+    }
+    pending_cv_.notify_one();
+}
+
+void BackgroundStateSaver::Flush() {
+    std::unique_lock lock{mutex_};
+    idle_cv_.wait(lock, [this] {
+        return !has_pending_ && !is_writing_;
+    });
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+uint64_t BackgroundStateSaver::GetSavedCount() const {
+    std::lock_guard lock{mutex_};
+    return saved_count_;
+}
+
+uint64_t BackgroundStateSaver::GetDroppedCount() const {
+    std::lock_guard lock{mutex_};
+    return dropped_count_;
+}
+
+std::optional<uint64_t> BackgroundStateSaver::GetSavedTick() const {
+    std::lock_guard lock{mutex_};
+    return saved_tick_;
+}
+
+void BackgroundStateSaver::Run(std::stop_token stop) {
+    std::unique_lock lock{mutex_};
+    // При остановке ожидание прерывается, но уже снятый снимок всё равно записывается
+    while (pending_cv_.wait(lock, stop, [this] {
+        return has_pending_;
+    })) {
+        std::swap(pending_, writing_);
+        const size_t count = pending_count_;
+        const uint64_t tick = pending_tick_;
+        has_pending_ = false;
+        is_writing_ = true;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            WriteFileAtomically(path_, SerializeDogs(tick, std::span{writing_}.first(count)));
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        is_writing_ = false;
+        if (error) {
+            error_ = error;
+        } else {
+            ++saved_count_;
+            saved_tick_ = tick;
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+SavedState LoadSavedState(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open "s + path.string());
+    }
+    std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    uint32_t checksum = 0;
+    if (data.size() < sizeof(checksum)) {
+        throw std::runtime_error("Saved dog state is truncated");
+    }
+    std::memcpy(&checksum, data.data() + data.size() - sizeof(checksum), sizeof(checksum));
+    data.resize(data.size() - sizeof(checksum));
+    if (Checksum(data) != checksum) {
+        throw std::runtime_error("Saved dog state is corrupted");
+    }
+
+    const size_t archive_size = data.size();
+    std::istringstream in(std::move(data), std::ios::binary);
+    boost::archive::binary_iarchive ar{in};
+    SavedState state;
+    uint64_t count = 0;
+    ar >> state.tick >> count;
+
+    // Каждая собака занимает в архиве хотя бы байт, так что большее число - ошибка записи,
+    // и резервировать под него память нельзя
+    const auto position = in.tellg();
+    if (position < 0 || count > archive_size - static_cast<size_t>(position)) {
+        throw std::runtime_error("Saved dog state has a wrong dog count");
+    }
+    state.dogs.reserve(count);
+    DogRepr repr;
+    for (uint64_t i = 0; i < count; ++i) {
+        ar >> repr;
+        state.dogs.push_back(repr.Restore());
+    }
+    return state;
+}
+
+}  // namespace serialization
@@ -0,0 +1,88 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "model.h"
+#include "model_serialization.h"
+
+namespace serialization {
+
+/*
+ * Сохранение состояния собак без остановки тика.
+ * Capture в потоке тика копирует собак в заранее выделенный буфер (DogRepr переиспользуют свою
+ * память) и сразу возвращается. Фоновый поток забирает буфер, сериализует его, пишет во временный
+ * файл, делает fsync и переименовывает файл в path, так что на диске всегда лежит целый снимок.
+ * Буферов два: пока один пишется на диск, второй принимает следующий снимок. Если фоновый поток
+ * не успел забрать предыдущий снимок, он заменяется новым.
+ * Вместе с собаками записывается номер тика снимка. По GetSavedTick видно, какой снимок уже на
+ * диске: после этого журнал изменений до этого тика можно освобождать (StateJournal::ReleaseUpTo).
+ */
+class BackgroundStateSaver {
+public:
+    // expected_dogs - сколько собак зарезервировать в буферах заранее
+    explicit BackgroundStateSaver(std::filesystem::path path, size_t expected_dogs = 0);
+
+    BackgroundStateSaver(const BackgroundStateSaver&) = delete;
+    BackgroundStateSaver& operator=(const BackgroundStateSaver&) = delete;
+
+    // Дописывает последний снятый снимок и останавливает фоновый поток
+    ~BackgroundStateSaver();
+
+    // Снимает состояние dogs на тик tick для сохранения. Не ждёт записи на диск
+    void Capture(std::span<const model::DogPtr> dogs, uint64_t tick);
+
+    // Ждёт, пока все снятые снимки будут записаны. Если запись не удалась, бросает её исключение
+    void Flush();
+
+    // Число снимков, записанных на диск
+    uint64_t GetSavedCount() const;
+
+    // Число снимков, заменённых следующими до того, как их успели записать
+    uint64_t GetDroppedCount() const;
+
+    // Тик последнего снимка, записанного на диск. nullopt, если ни один ещё не записан
+    std::optional<uint64_t> GetSavedTick() const;
+
+private:
+    void Run(std::stop_token stop);
+
+    std::filesystem::path path_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any pending_cv_;
+    std::condition_variable idle_cv_;
+    std::vector<DogRepr> pending_;
+    size_t pending_count_ = 0;
+    uint64_t pending_tick_ = 0;
+    bool has_pending_ = false;
+    bool is_writing_ = false;
+    uint64_t saved_count_ = 0;
+    uint64_t dropped_count_ = 0;
+    std::optional<uint64_t> saved_tick_;
+    std::exception_ptr error_;
+
+    // Буфер, который сейчас пишет фоновый поток. Доступен только ему
+    std::vector<DogRepr> writing_;
+
+    // Объявлен последним: поток останавливается до разрушения остальных полей
+    std::jthread worker_;
+};
+
+// Снимок, записанный BackgroundStateSaver
+struct SavedState {
+    uint64_t tick = 0;
+    std::vector<model::Dog> dogs;
+};
+
+// Загружает снимок из файла, записанного BackgroundStateSaver. Файл заканчивается CRC-32
+// остального содержимого: обрезанный или повреждённый снимок отвергается с std::runtime_error
+SavedState LoadSavedState(const std::filesystem::path& path);
+
+}  // namespace serialization
@@ -0,0 +1,391 @@
+#include "state_snapshot.h"
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "file_util.h"
+#include "model_serialization.h"
+
+namespace serialization {
+using namespace std::literals;
+
+namespace {
+
+constexpr std::array<char, 8> MAGIC = {'D', 'O', 'G', 'S', 'T', 'A', 'T', 'E'};
+constexpr uint32_t FORMAT_VERSION = 2;
+
+// Запись файла: вид (1 байт), размер данных (8 байт), CRC-32 данных (4 байта) и сами данные -
+// архив boost без заголовка
+enum class RecordKind : uint8_t {
+    BASE = 1,
+    DELTA = 2,
+};
+
+// Изменения одной собаки. Сериализуются только поля, отмеченные в mask
+class DogDelta {
+public:
+    enum Field : uint8_t {
+        POSITION = 1 << 0,
+        SPEED = 1 << 1,
+        DIRECTION = 1 << 2,
+        SCORE = 1 << 3,
+        BAG = 1 << 4,
+    };
+
+    DogDelta() = default;
+
+    DogDelta(const model::Dog& dog, uint32_t id, uint8_t mask)
+        : id_(id)
+        , mask_(mask)
+        , pos_(dog.GetPosition())
+        , speed_(dog.GetSpeed())
+        , direction_(dog.GetDirection())
+        , score_(dog.GetScore()) {
+        if (mask & BAG) {
+            bag_content_ = dog.GetBagContent();
+        }
+    }
+
+    uint32_t GetId() const noexcept {
+        return id_;
+    }
+
+    void ApplyTo(model::Dog& dog) const {
+        if (mask_ & POSITION) {
+            dog.SetPosition(pos_);
+        }
+        if (mask_ & SPEED) {
+            dog.SetSpeed(speed_);
+        }
+        if (mask_ & DIRECTION) {
+            dog.SetDirection(direction_);
+        }
+        if (mask_ & SCORE) {
+            // Беззнаковая разность даёт нужный счёт и при его уменьшении
+            dog.AddScore(score_ - dog.GetScore());
+        }
+        if (mask_ & BAG) {
+            dog.EmptyBag();
+            for (const auto& item : bag_content_) {
+                if (!dog.PutToBag(item)) {
+                    throw std::runtime_error("Failed to put bag content");
+                }
+            }
+        }
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+        ar& id_;
+        ar& mask_;
+        if (mask_ & POSITION) {
+            ar& pos_;
+        }
+        if (mask_ & SPEED) {
+            ar& speed_;
+        }
+        if (mask_ & DIRECTION) {
+            ar& direction_;
+        }
+        if (mask_ & SCORE) {
+            ar& score_;
+        }
+        if (mask_ & BAG) {
+            ar& bag_content_;
+        }
+    }
+
+private:
+    uint32_t id_ = 0;
+    uint8_t mask_ = 0;
+    geom::Point2D pos_;
+    geom::Vec2D speed_;
+    model::Direction direction_ = model::Direction::NORTH;
+    model::Score score_ = 0;
+    model::Dog::BagContent bag_content_;
+};
+
+struct StateDelta {
+    std::vector<DogRepr> added;
+    std::vector<DogDelta> changed;
+    std::vector<uint32_t> removed;
+
+    template <typename Archive>
+    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+        ar& added;
+        ar& changed;
+        ar& removed;
+    }
+};
+
+template <typename T>
+std::string ToBytes(const T& value) {
+    std::ostringstream out(std::ios::binary);
+    {
+        boost::archive::binary_oarchive ar{out, boost::archive::no_header};
+        ar << value;
+    }
+    return std::move(out).str();
+}
+
+template <typename T>
+T FromBytes(const std::string& bytes) {
+    std::istringstream in(bytes, std::ios::binary);
+    boost::archive::binary_iarchive ar{in, boost::archive::no_header};
+    T value;
+    ar >> value;
+    return value;
+}
+
+uint32_t Checksum(std::string_view data) {
+    boost::crc_32_type crc;
+    crc.process_bytes(data.data(), data.size());
+    return crc.checksum();
+}
+
+template <typename T>
+void AppendBytes(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendFileHeader(std::string& out) {
+    out.append(MAGIC.data(), MAGIC.size());
+    AppendBytes(out, FORMAT_VERSION);
+}
+
+void AppendRecord(std::string& out, RecordKind kind, std::string_view payload) {
+    out.push_back(static_cast<char>(kind));
+    AppendBytes(out, static_cast<uint64_t>(payload.size()));
+    AppendBytes(out, Checksum(payload));
+    out.append(payload);
+}
+
+// Читает очередную запись. false - записи кончились или последняя запись недописана либо
+// повреждена. Такая запись может быть только последней: после неудачной записи Save пишет
+// файл заново
+bool ReadRecord(std::istream& in, RecordKind& kind, std::string& payload) {
+    char kind_byte = 0;
+    uint64_t size = 0;
+    uint32_t checksum = 0;
+    if (!in.get(kind_byte) || !in.read(reinterpret_cast<char*>(&size), sizeof(size))
+        || !in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum))) {
+        return false;
+    }
+    kind = static_cast<RecordKind>(kind_byte);
+    if (kind != RecordKind::BASE && kind != RecordKind::DELTA) {
+        return false;
+    }
+    // Размер недописанной записи может быть любым, поэтому не выделяем больше, чем осталось в файле
+    const auto position = in.tellg();
+    in.seekg(0, std::ios::end);
+    const auto file_size = in.tellg();
+    in.seekg(position);
+    if (position < 0 || file_size < position || size > static_cast<uint64_t>(file_size - position)) {
+        return false;
+    }
+    payload.resize(size);
+    return in.read(payload.data(), static_cast<std::streamsize>(size)) && Checksum(payload) == checksum;
+}
+
+}  // namespace
+
+IncrementalStateWriter::DogState::DogState(const model::Dog& dog)
+    : name(dog.GetName())
+    , bag_capacity(dog.GetBagCapacity())
+    , pos(dog.GetPosition())
+    , speed(dog.GetSpeed())
+    , direction(dog.GetDirection())
+    , score(dog.GetScore())
+    , bag(dog.GetBagContent()) {
+}
+
+IncrementalStateWriter::IncrementalStateWriter(std::filesystem::path path, size_t max_deltas)
+    : path_(std::move(path))
+    , max_deltas_(max_deltas) {
+}
+
+void IncrementalStateWriter::Save(std::span<const model::DogPtr> dogs) {
+    try {
+        if (!has_base_ || deltas_since_base_ >= max_deltas_ || delta_bytes_ > base_bytes_) {
+            WriteBase(dogs);
+        } else {
+            WriteDelta(dogs);
+        }
+    } catch (...) {
+        // В конце файла могла остаться недописанная дельта. Новый базовый снимок заменит файл целиком
+        RequestBase();
+        throw;
+    }
+}
+
+void IncrementalStateWriter::WriteBase(std::span<const model::DogPtr> dogs) {
+    std::vector<DogRepr> reprs;
+    reprs.reserve(dogs.size());
+    SavedDogs saved;
+    saved.reserve(dogs.size());
+    for (const auto& dog : dogs) {
+        reprs.emplace_back(*dog);
+        saved.insert_or_assign(*dog->GetId(), DogState{*dog});
+    }
+    const std::string payload = ToBytes(reprs);
+
+    std::string data;
+    AppendFileHeader(data);
+    AppendRecord(data, RecordKind::BASE, payload);
+    WriteFileAtomically(path_, data);
+
+    saved_ = std::move(saved);
+    has_base_ = true;
+    deltas_since_base_ = 0;
+    base_bytes_ = payload.size();
+    delta_bytes_ = 0;
+}
+
+void IncrementalStateWriter::WriteDelta(std::span<const model::DogPtr> dogs) {
+    // saved_ меняется только после того, как дельта записана на диск: иначе после неудачной
+    // записи следующая дельта считалась бы от состояния, которого в файле нет
+    StateDelta delta;
+    std::vector<const model::Dog*> updated;
+    size_t known_dogs = 0;
+    for (const auto& dog : dogs) {
+        const uint32_t id = *dog->GetId();
+        const auto it = saved_.find(id);
+        if (it == saved_.end()) {
+            delta.added.emplace_back(*dog);
+            updated.push_back(dog.get());
+            continue;
+        }
+
+        ++known_dogs;
+        const DogState& saved = it->second;
+        if (dog->GetName() != saved.name || dog->GetBagCapacity() != saved.bag_capacity) {
+            // id прежней собаки достался новой: прежнюю удаляем, новую записываем целиком
+            delta.removed.push_back(id);
+            delta.added.emplace_back(*dog);
+            updated.push_back(dog.get());
+            continue;
+        }
+        uint8_t mask = 0;
+        if (dog->GetPosition() != saved.pos) {
+            mask |= DogDelta::POSITION;
+        }
+        if (dog->GetSpeed() != saved.speed) {
+            mask |= DogDelta::SPEED;
+        }
+        if (dog->GetDirection() != saved.direction) {
+            mask |= DogDelta::DIRECTION;
+        }
+        if (dog->GetScore() != saved.score) {
+            mask |= DogDelta::SCORE;
+        }
+        if (dog->GetBagContent() != saved.bag) {
+            mask |= DogDelta::BAG;
+        }
+        if (mask != 0) {
+            delta.changed.emplace_back(*dog, id, mask);
+            updated.push_back(dog.get());
+        }
+    }
+    // Среди сохранённых есть собаки, которых больше нет
+    if (saved_.size() > known_dogs) {
+        std::unordered_set<uint32_t> present;
+        present.reserve(dogs.size());
+        for (const auto& dog : dogs) {
+            present.insert(*dog->GetId());
+        }
+        for (const auto& [id, state] : saved_) {
+            if (!present.contains(id)) {
+                delta.removed.push_back(id);
+            }
+        }
+    }
+    std::sort(delta.removed.begin(), delta.removed.end());
+
+    const std::string payload = ToBytes(delta);
+    std::string record;
+    AppendRecord(record, RecordKind::DELTA, payload);
+    AppendToFile(path_, record);
+
+    // Сначала удаления: id из removed может снова оказаться среди добавленных
+    for (const uint32_t id : delta.removed) {
+        saved_.erase(id);
+    }
+    for (const model::Dog* dog : updated) {
+        saved_.insert_or_assign(*dog->GetId(), DogState{*dog});
+    }
+    ++deltas_since_base_;
+    delta_bytes_ += payload.size();
+}
+
+std::vector<model::Dog> RestoreIncrementalState(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Could not open "s + path.string());
+    }
+    std::array<char, MAGIC.size()> magic{};
+    uint32_t version = 0;
+    if (!in.read(magic.data(), magic.size()) || magic != MAGIC
+        || !in.read(reinterpret_cast<char*>(&version), sizeof(version))) {
+        throw std::runtime_error("Not a dog state file");
+    }
+    if (version != FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported dog state version "s + std::to_string(version));
+    }
+
+    RecordKind kind{};
+    std::string payload;
+    if (!ReadRecord(in, kind, payload) || kind != RecordKind::BASE) {
+        throw std::runtime_error("Dog state has no base snapshot");
+    }
+    std::unordered_map<uint32_t, model::Dog> dogs;
+    for (const auto& repr : FromBytes<std::vector<DogRepr>>(payload)) {
+        auto dog = repr.Restore();
+        const uint32_t id = *dog.GetId();
+        dogs.insert_or_assign(id, std::move(dog));
+    }
+
+    while (ReadRecord(in, kind, payload)) {
+        if (kind != RecordKind::DELTA) {
+            throw std::runtime_error("Unexpected base snapshot in dog state");
+        }
+        const auto delta = FromBytes<StateDelta>(payload);
+        // Удаления применяются первыми: собака с тем же id может быть среди добавленных
+        for (const uint32_t id : delta.removed) {
+            dogs.erase(id);
+        }
+        for (const auto& repr : delta.added) {
+            auto dog = repr.Restore();
+            const uint32_t id = *dog.GetId();
+            dogs.insert_or_assign(id, std::move(dog));
+        }
+        for (const auto& change : delta.changed) {
+            const auto it = dogs.find(change.GetId());
+            if (it == dogs.end()) {
+                throw std::runtime_error("Dog state delta refers to unknown dog");
+            }
+            change.ApplyTo(it->second);
+        }
+    }
+
+    std::vector<model::Dog> result;
+    result.reserve(dogs.size());
+    for (auto& [id, dog] : dogs) {
+        result.push_back(std::move(dog));
+    }
+    std::sort(result.begin(), result.end(), [](const model::Dog& lhs, const model::Dog& rhs) {
+        return lhs.GetId() < rhs.GetId();
+    });
+    return result;
+}
+
+}  // namespace serialization
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "model.h"
+
+namespace serialization {
+
+/*
+ * Инкрементальное сохранение состояния собак.
+ * Файл начинается с базового снимка всех собак (DogRepr), за которым дописываются дельты.
+ * Дельта содержит только собак, у которых с прошлого сохранения изменились позиция, скорость,
+ * направление, рюкзак или счёт, причём только изменившиеся поля. Кроме них в дельту попадают
+ * новые собаки (целиком) и id удалённых. Если id удалённой собаки достался новой (у неё другие
+ * имя или вместимость рюкзака), в дельту попадают и удаление, и добавление.
+ * Когда дельт становится слишком много или вместе они становятся больше базы, при очередном
+ * сохранении пишется новый базовый снимок: во временный файл, который затем заменяет старый.
+ * Каждая запись сбрасывается на диск (fsync) и содержит CRC-32. Если запись не удалась, Save
+ * бросает исключение, а следующий Save пишет базовый снимок.
+ */
+class IncrementalStateWriter {
+public:
+    // После базового снимка дописывается не больше max_deltas дельт
+    explicit IncrementalStateWriter(std::filesystem::path path, size_t max_deltas = 32);
+
+    // Сохраняет состояние dogs: базовым снимком или дельтой относительно последнего успешного
+    // сохранения. id собак должны быть уникальны
+    void Save(std::span<const model::DogPtr> dogs);
+
+    // Следующий Save запишет базовый снимок
+    void RequestBase() noexcept {
+        has_base_ = false;
+    }
+
+    size_t GetDeltasSinceBase() const noexcept {
+        return deltas_since_base_;
+    }
+
+private:
+    // Состояние собаки на момент сохранения. Имя и вместимость рюкзака у собаки не меняются,
+    // по ним видно, что тот же id получила другая собака
+    struct DogState {
+        explicit DogState(const model::Dog& dog);
+
+        std::string name;
+        size_t bag_capacity;
+        geom::Point2D pos;
+        geom::Vec2D speed;
+        model::Direction direction;
+        model::Score score;
+        model::Dog::BagContent bag;
+    };
+
+    using SavedDogs = std::unordered_map<uint32_t, DogState>;
+
+    void WriteBase(std::span<const model::DogPtr> dogs);
+    void WriteDelta(std::span<const model::DogPtr> dogs);
+
+    std::filesystem::path path_;
+    size_t max_deltas_;
+    bool has_base_ = false;
+    size_t deltas_since_base_ = 0;
+    uint64_t base_bytes_ = 0;
+    uint64_t delta_bytes_ = 0;
+    // Состояние собак, которое записано на диск
+    SavedDogs saved_;
+};
+
+// Восстанавливает собак из базового снимка и всех дельт после него, в порядке возрастания id.
+// Недописанная или повреждённая последняя запись (сбой во время сохранения) отбрасывается
+std::vector<model::Dog> RestoreIncrementalState(const std::filesystem::path& path);
+
+}  // namespace serialization
@@ -1,10 +1,26 @@
+#include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
+#include <boost/crc.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <random>
 #include <sstream>
 
+#include "../src/dog_codec.h"
+#include "../src/dog_registry.h"
 #include "../src/model.h"
 #include "../src/model_serialization.h"
+#include "../src/movement.h"
+#include "../src/state_journal.h"
+#include "../src/state_saver.h"
+#include "../src/state_snapshot.h"
 
 using namespace model;
 using namespace std::literals;
@@ -69,3 +85,663 @@ SCENARIO_METHOD(Fixture, "Dog Serialization") {
         }
     }
 }
+
+namespace {
+
+DogPtr MakeDog(uint32_t id, double x) {
+    auto dog = std::make_shared<Dog>(Dog::Id{id}, "Dog "s + std::to_string(id), geom::Point2D{x, 0.0}, 3);
+    dog->SetSpeed({1.0, 0.0});
+    return dog;
+}
+
+void CheckSameDogs(const std::vector<DogPtr>& expected, const std::vector<Dog>& restored) {
+    REQUIRE(expected.size() == restored.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const Dog& dog = *expected[i];
+        CHECK(dog.GetId() == restored[i].GetId());
+        CHECK(dog.GetName() == restored[i].GetName());
+        CHECK(dog.GetPosition() == restored[i].GetPosition());
+        CHECK(dog.GetSpeed() == restored[i].GetSpeed());
+        CHECK(dog.GetDirection() == restored[i].GetDirection());
+        CHECK(dog.GetScore() == restored[i].GetScore());
+        CHECK(dog.GetBagCapacity() == restored[i].GetBagCapacity());
+        CHECK(dog.GetBagContent() == restored[i].GetBagContent());
+    }
+}
+
+}  // namespace
+
+SCENARIO("Incremental state saving") {
+    const auto path = std::filesystem::temp_directory_path() / "incremental-state-test.bin";
+    std::vector<DogPtr> dogs;
+    for (uint32_t id = 0; id < 100; ++id) {
+        dogs.push_back(MakeDog(id, id));
+    }
+
+    GIVEN("a base snapshot") {
+        serialization::IncrementalStateWriter writer{path};
+        writer.Save(dogs);
+        const auto base_size = std::filesystem::file_size(path);
+        CheckSameDogs(dogs, serialization::RestoreIncrementalState(path));
+
+        WHEN("a few dogs change, one is removed and one is added") {
+            dogs[3]->SetPosition({3.5, 1.0});
+            dogs[10]->AddScore(7);
+            CHECK(dogs[10]->PutToBag({FoundObject::Id{5}, 1u}));
+            dogs[20]->SetDirection(Direction::WEST);
+            dogs[20]->SetSpeed({0.0, -1.0});
+            dogs.erase(dogs.begin() + 50);
+            dogs.push_back(MakeDog(1000, 5.0));
+            writer.Save(dogs);
+
+            THEN("only a small delta is appended and restore replays it") {
+                CHECK(writer.GetDeltasSinceBase() == 1);
+                CHECK(std::filesystem::file_size(path) - base_size < base_size / 10);
+                CheckSameDogs(dogs, serialization::RestoreIncrementalState(path));
+            }
+
+            AND_WHEN("the bag is emptied in the next delta") {
+                dogs[10]->EmptyBag();
+                writer.Save(dogs);
+
+                THEN("both deltas are replayed") {
+                    CHECK(writer.GetDeltasSinceBase() == 2);
+                    CheckSameDogs(dogs, serialization::RestoreIncrementalState(path));
+                }
+            }
+
+            AND_WHEN("the last delta is cut short") {
+                const auto full_size = std::filesystem::file_size(path);
+                std::filesystem::resize_file(path, full_size - 3);
+
+                THEN("restore stops at the base snapshot") {
+                    const auto restored = serialization::RestoreIncrementalState(path);
+                    CHECK(restored.size() == 100);
+                    CHECK(restored[3].GetPosition() == geom::Point2D{3.0, 0.0});
+                }
+            }
+
+
+            AND_WHEN("a byte of the last delta is corrupted") {
+                {
+                    std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+                    file.seekp(-1, std::ios::end);
+                    file.put('\xff');
+                }
+
+                THEN("the delta fails its checksum and restore stops at the base snapshot") {
+                    const auto restored = serialization::RestoreIncrementalState(path);
+                    CHECK(restored.size() == 100);
+                    CHECK(restored[3].GetPosition() == geom::Point2D{3.0, 0.0});
+                }
+            }
+        }
+
+        WHEN("a dog is replaced by another one with the same id") {
+            // Та же позиция и скорость: по изменяемым полям замену не заметить
+            dogs[7] = std::make_shared<Dog>(Dog::Id{7}, "Another dog"s, dogs[7]->GetPosition(), 5);
+            dogs[7]->SetSpeed({1.0, 0.0});
+            writer.Save(dogs);
+
+            THEN("restore gets the new dog with its name and bag capacity") {
+                CHECK(writer.GetDeltasSinceBase() == 1);
+                CheckSameDogs(dogs, serialization::RestoreIncrementalState(path));
+            }
+
+            AND_WHEN("the new dog moves in the next delta") {
+                dogs[7]->SetPosition({7.5, 1.0});
+                writer.Save(dogs);
+
+                THEN("the change is saved against the new dog") {
+                    CHECK(writer.GetDeltasSinceBase() == 2);
+                    CheckSameDogs(dogs, serialization::RestoreIncrementalState(path));
+                }
+            }
+        }
+
+        WHEN("appending a delta fails") {
+            std::filesystem::remove(path);
+            dogs[3]->SetPosition({3.5, 1.0});
+            CHECK_THROWS(writer.Save(dogs));
+
+            THEN("the next save writes a base with the state that was not saved") {
+                writer.Save(dogs);
+                CHECK(writer.GetDeltasSinceBase() == 0);
+                CheckSameDogs(dogs, serialization::RestoreIncrementalState(path));
+
+                dogs[4]->SetPosition({4.5, 1.0});
+                writer.Save(dogs);
+                CHECK(writer.GetDeltasSinceBase() == 1);
+                CheckSameDogs(dogs, serialization::RestoreIncrementalState(path));
+            }
+        }
+
+        WHEN("max_deltas deltas have been written") {
+            serialization::IncrementalStateWriter short_writer{path, 2};
+            for (int i = 0; i < 3; ++i) {
+                dogs[0]->SetPosition({i * 1.0, 2.0});
+                short_writer.Save(dogs);
+            }
+            CHECK(short_writer.GetDeltasSinceBase() == 2);
+
+            THEN("the next save writes a new base") {
+                short_writer.Save(dogs);
+                CHECK(short_writer.GetDeltasSinceBase() == 0);
+                CheckSameDogs(dogs, serialization::RestoreIncrementalState(path));
+            }
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+SCENARIO("Background state saving") {
+    const auto path = std::filesystem::temp_directory_path() / "background-state-test.bin";
+    std::vector<DogPtr> dogs;
+    for (uint32_t id = 0; id < 1000; ++id) {
+        dogs.push_back(MakeDog(id, id));
+    }
+    CHECK(dogs[1]->PutToBag({FoundObject::Id{1}, 2u}));
+
+    GIVEN("a saver") {
+        serialization::BackgroundStateSaver saver{path, dogs.size()};
+
+        THEN("no tick is saved yet") {
+            CHECK_FALSE(saver.GetSavedTick());
+        }
+
+        WHEN("the state is captured and flushed") {
+            saver.Capture(dogs, 7);
+            saver.Flush();
+
+            THEN("the file holds the captured dogs and their tick") {
+                CHECK(saver.GetSavedCount() == 1);
+                CHECK(saver.GetSavedTick() == 7u);
+                const auto saved = serialization::LoadSavedState(path);
+                CHECK(saved.tick == 7);
+                CheckSameDogs(dogs, saved.dogs);
+            }
+
+            THEN("a corrupted or truncated file is rejected") {
+                std::string data;
+                {
+                    std::ifstream in{path, std::ios::binary};
+                    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                }
+                const auto check_rejected = [&path](const std::string& content) {
+                    {
+                        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+                        out << content;
+                    }
+                    CHECK_THROWS_AS(serialization::LoadSavedState(path), std::runtime_error);
+                };
+                auto flipped = data;
+                flipped[flipped.size() / 2] ^= 0x10;
+                check_rejected(flipped);
+                check_rejected(data.substr(0, data.size() - 1));
+                check_rejected(data.substr(0, data.size() / 2));
+                check_rejected(""s);
+            }
+
+            THEN("a dog count past the end of the file is rejected even with a valid checksum") {
+                std::ostringstream out(std::ios::binary);
+                {
+                    boost::archive::binary_oarchive ar{out};
+                    const uint64_t tick = 7;
+                    const uint64_t count = uint64_t{1} << 40;
+                    ar << tick << count;
+                }
+                std::string data = std::move(out).str();
+                boost::crc_32_type crc;
+                crc.process_bytes(data.data(), data.size());
+                const uint32_t checksum = crc.checksum();
+                data.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+                {
+                    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+                    file << data;
+                }
+                CHECK_THROWS_AS(serialization::LoadSavedState(path), std::runtime_error);
+            }
+        }
+
+        WHEN("dogs change after a capture") {
+            saver.Capture(dogs, 1);
+            const std::vector<DogPtr> captured = [&dogs] {
+                std::vector<DogPtr> copy;
+                for (const auto& dog : dogs) {
+                    copy.push_back(std::make_shared<Dog>(*dog));
+                }
+                return copy;
+            }();
+            for (const auto& dog : dogs) {
+                dog->SetPosition({-1.0, -1.0});
+                dog->AddScore(1);
+            }
+            saver.Flush();
+
+            THEN("the saved state is the one at the moment of capture") {
+                CheckSameDogs(captured, serialization::LoadSavedState(path).dogs);
+            }
+        }
+
+        WHEN("several captures happen in a row") {
+            for (int i = 0; i < 20; ++i) {
+                dogs[0]->SetPosition({i * 1.0, 0.0});
+                dogs.push_back(MakeDog(2000 + i, i));
+                saver.Capture(dogs, i);
+            }
+            saver.Flush();
+
+            THEN("the last capture ends up on disk") {
+                CHECK(saver.GetSavedCount() + saver.GetDroppedCount() == 20);
+                CHECK(saver.GetSavedTick() == 19u);
+                const auto saved = serialization::LoadSavedState(path);
+                CHECK(saved.tick == 19);
+                CheckSameDogs(dogs, saved.dogs);
+            }
+        }
+    }
+
+    WHEN("the saver is destroyed right after a capture") {
+        {
+            serialization::BackgroundStateSaver saver{path};
+            dogs.pop_back();
+            saver.Capture(dogs, 3);
+        }
+
+        THEN("the capture is still written") {
+            const auto saved = serialization::LoadSavedState(path);
+            CHECK(saved.tick == 3);
+            CheckSameDogs(dogs, saved.dogs);
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+SCENARIO("Compact dog codec") {
+    std::vector<DogPtr> dogs;
+    for (uint32_t id = 0; id < 300; ++id) {
+        // Часть имён повторяется
+        auto dog = std::make_shared<Dog>(Dog::Id{id * 1000}, "Rex "s + std::to_string(id % 7),
+                                         geom::Point2D{id * 0.5, -1.25 * id}, id % 5);
+        dog->SetSpeed({-0.1 * id, 3.0});
+        dog->SetDirection(static_cast<Direction>(id % 4));
+        dog->AddScore(id * 100'000);
+        for (uint32_t i = 0; i < id % 5; ++i) {
+            CHECK(dog->PutToBag({FoundObject::Id{id * 1'000'000 + i}, i}));
+        }
+        dogs.push_back(std::move(dog));
+    }
+
+    GIVEN("encoded dogs") {
+        std::string buffer;
+        serialization::EncodeDogs(dogs, buffer);
+
+        THEN("they are decoded back") {
+            serialization::DecodedDogs decoded;
+            serialization::DecodeDogs(buffer, decoded);
+            REQUIRE(decoded.GetCount() == dogs.size());
+            CHECK(decoded.GetName(8) == "Rex 1"sv);
+            CheckSameDogs(dogs, decoded.RestoreAll());
+
+            AND_THEN("decoding again into the same object gives the same result") {
+                serialization::DecodeDogs(buffer, decoded);
+                CheckSameDogs(dogs, decoded.RestoreAll());
+            }
+        }
+
+        THEN("the buffer is smaller than a boost binary archive") {
+            std::stringstream boost_strm;
+            boost::archive::binary_oarchive boost_archive{boost_strm};
+            for (const auto& dog : dogs) {
+                boost_archive << serialization::DogRepr{*dog};
+            }
+            CHECK(buffer.size() < boost_strm.str().size());
+        }
+
+        WHEN("the buffer is damaged") {
+            serialization::DecodedDogs decoded;
+
+            THEN("decoding fails") {
+                CHECK_THROWS_AS(serialization::DecodeDogs(std::string_view{buffer}.substr(0, buffer.size() - 1), decoded),
+                                std::runtime_error);
+                CHECK_THROWS_AS(serialization::DecodeDogs(buffer + "x"s, decoded), std::runtime_error);
+                std::string bad_version = buffer;
+                bad_version[4] = 2;
+                CHECK_THROWS_AS(serialization::DecodeDogs(bad_version, decoded), std::runtime_error);
+            }
+        }
+    }
+
+    GIVEN("a single dog with a one-letter name") {
+        const std::vector<DogPtr> one_dog{std::make_shared<Dog>(Dog::Id{1}, "R"s, geom::Point2D{}, 3)};
+        std::string buffer;
+        serialization::EncodeDogs(one_dog, buffer);
+        // Заголовок 20 байт, затем длина имени (1 байт) и само имя, затем запись собаки
+        constexpr size_t NAME_SIZE_OFFSET = 20;
+        constexpr size_t BAG_CAPACITY_OFFSET = NAME_SIZE_OFFSET + 2 + 44;
+        serialization::DecodedDogs decoded;
+
+        WHEN("the bag capacity is replaced with a huge value") {
+            std::memset(buffer.data() + BAG_CAPACITY_OFFSET, 0xff, sizeof(uint32_t));
+
+            THEN("decoding fails instead of reserving the bag") {
+                CHECK_THROWS_AS(serialization::DecodeDogs(buffer, decoded), std::runtime_error);
+            }
+        }
+
+        WHEN("the name size is a five-byte varint with extra high bits") {
+            // Без лишних битов пятого байта это значение равно 1
+            buffer.replace(NAME_SIZE_OFFSET, 1, "\x81\x80\x80\x80\x10"sv);
+
+            THEN("decoding fails") {
+                CHECK_THROWS_AS(serialization::DecodeDogs(buffer, decoded), std::runtime_error);
+            }
+        }
+
+        WHEN("a dog with a bag beyond the limit is encoded") {
+            const std::vector<DogPtr> big_bag{
+                std::make_shared<Dog>(Dog::Id{1}, "R"s, geom::Point2D{}, serialization::MAX_BAG_CAPACITY + 1)};
+
+            THEN("encoding fails") {
+                CHECK_THROWS_AS(serialization::EncodeDogs(big_bag, buffer), std::length_error);
+            }
+        }
+    }
+}
+
+SCENARIO("State journal") {
+    const auto dir = std::filesystem::temp_directory_path() / "state-journal-test";
+    std::filesystem::remove_all(dir);
+    std::vector<DogPtr> dogs;
+    for (uint32_t id = 0; id < 10; ++id) {
+        dogs.push_back(MakeDog(id, id));
+    }
+    // Снимок на тик 0
+    std::vector<Dog> snapshot;
+    for (const auto& dog : dogs) {
+        snapshot.push_back(serialization::DogRepr{*dog}.Restore());
+    }
+
+    GIVEN("a journal with a few committed ticks") {
+        // Маленькие сегменты, чтобы журнал переходил на новые
+        std::optional<serialization::StateJournal> journal{std::in_place, dir, 256};
+        for (uint64_t tick = 1; tick <= 20; ++tick) {
+            auto& dog = *dogs[tick % dogs.size()];
+            journal->SetPosition(dog, {tick * 1.5, 2.0});
+            journal->SetSpeed(dog, {0.0, tick * 1.0});
+            journal->SetDirection(dog, Direction::SOUTH);
+            journal->AddScore(dog, 3);
+            if (!journal->PutToBag(dog, {FoundObject::Id{static_cast<uint32_t>(tick)}, 1u})) {
+                journal->EmptyBag(dog);
+            }
+            if (tick == 10) {
+                auto new_dog = MakeDog(100, 1.0);
+                new_dog->AddScore(5);
+                CHECK(new_dog->PutToBag({FoundObject::Id{77}, 3u}));
+                journal->AddDog(*new_dog);
+                dogs.push_back(std::move(new_dog));
+            }
+            journal->CommitTick(tick);
+        }
+        CHECK(std::distance(std::filesystem::directory_iterator{dir}, {}) > 1);
+
+        WHEN("it is replayed on top of the snapshot") {
+            journal.reset();
+            auto restored = snapshot;
+            const auto last_tick = serialization::ReplayJournal(dir, 0, restored);
+
+            THEN("the current state is restored") {
+                CHECK(last_tick == 20);
+                CheckSameDogs(dogs, restored);
+            }
+        }
+
+        WHEN("the process dies before a tick is committed") {
+            const auto committed = [&dogs] {
+                std::vector<DogPtr> copy;
+                for (const auto& dog : dogs) {
+                    copy.push_back(std::make_shared<Dog>(*dog));
+                }
+                return copy;
+            }();
+            journal->SetPosition(*dogs[0], {-5.0, -5.0});
+
+            THEN("replay gives the state of the last committed tick") {
+                // Журнал не закрывается: сегмент остаётся с нулевым хвостом, как после падения
+                auto restored = snapshot;
+                CHECK(serialization::ReplayJournal(dir, 0, restored) == 20);
+                CheckSameDogs(committed, restored);
+            }
+        }
+
+        WHEN("a snapshot for tick 20 is saved") {
+            journal->ReleaseUpTo(20);
+
+            THEN("old segments are removed") {
+                CHECK(std::distance(std::filesystem::directory_iterator{dir}, {}) == 1);
+                auto restored = snapshot;
+                CHECK(serialization::ReplayJournal(dir, 20, restored) == 20);
+            }
+        }
+
+        WHEN("the last batch is damaged") {
+            journal.reset();
+            std::vector<std::filesystem::path> segments{std::filesystem::directory_iterator{dir}, {}};
+            std::sort(segments.begin(), segments.end());
+            const auto last = segments.back();
+            std::filesystem::resize_file(last, std::filesystem::file_size(last) - 1);
+
+            THEN("replay stops before it") {
+                auto restored = snapshot;
+                CHECK(serialization::ReplayJournal(dir, 0, restored) == 19);
+            }
+        }
+
+        WHEN("the process died right after creating a segment") {
+            journal.reset();
+            // posix_fallocate успел, заголовок ещё не записан
+            const auto zero_segment = dir / "999999.journal";
+            std::ofstream{zero_segment};
+            std::filesystem::resize_file(zero_segment, 4096);
+
+            THEN("the zero-filled segment is treated as empty") {
+                auto restored = snapshot;
+                CHECK(serialization::ReplayJournal(dir, 0, restored) == 20);
+                CheckSameDogs(dogs, restored);
+                CHECK_NOTHROW(serialization::StateJournal{dir, 256});
+            }
+        }
+
+        WHEN("a batch in the first segment is damaged") {
+            journal.reset();
+            std::vector<std::filesystem::path> segments{std::filesystem::directory_iterator{dir}, {}};
+            std::sort(segments.begin(), segments.end());
+            REQUIRE(segments.size() > 2);
+            {
+                std::fstream file{segments.front(), std::ios::binary | std::ios::in | std::ios::out};
+                file.seekp(-1, std::ios::end);
+                file.put('\xff');
+            }
+            auto restored = snapshot;
+            const auto last_tick = serialization::ReplayJournal(dir, 0, restored);
+
+            THEN("replay stops there and does not apply the later segments") {
+                CHECK(last_tick < 20);
+                for (size_t i = 1; i < segments.size(); ++i) {
+                    std::filesystem::remove(segments[i]);
+                }
+                auto first_segment_only = snapshot;
+                CHECK(serialization::ReplayJournal(dir, 0, first_segment_only) == last_tick);
+                std::vector<DogPtr> expected;
+                for (const auto& dog : first_segment_only) {
+                    expected.push_back(std::make_shared<Dog>(dog));
+                }
+                CheckSameDogs(expected, restored);
+            }
+
+            AND_WHEN("the journal is reopened and written after the replay") {
+                std::vector<DogPtr> current;
+                for (const auto& dog : restored) {
+                    current.push_back(std::make_shared<Dog>(dog));
+                }
+                journal.emplace(dir, 256);
+                journal->SetPosition(*current[0], {-7.0, 7.0});
+                journal->CommitTick(last_tick + 1);
+                journal.reset();
+
+                THEN("the damaged tail is dropped and the new batches are replayed") {
+                    auto replayed = snapshot;
+                    CHECK(serialization::ReplayJournal(dir, 0, replayed) == last_tick + 1);
+                    CheckSameDogs(current, replayed);
+                }
+            }
+        }
+    }
+    std::filesystem::remove_all(dir);
+}
+
+SCENARIO("Dog registry") {
+    GIVEN("a registry with several dogs") {
+        DogRegistry registry{3};
+        std::vector<DogRegistry::Handle> handles;
+        for (uint32_t id = 0; id < 5; ++id) {
+            handles.push_back(registry.Add(Dog::Id{id}, "Dog "s + std::to_string(id), {id * 1.0, 0.0}));
+            const size_t index = registry.GetIndex(handles.back());
+            registry.SetSpeed(index, {0.0, id * 1.0});
+            registry.AddScore(index, id * 10);
+            for (uint32_t i = 0; i < id % 4; ++i) {
+                CHECK(registry.PutToBag(index, {FoundObject::Id{id * 100 + i}, i}));
+            }
+        }
+
+        THEN("dogs are reachable by handles") {
+            REQUIRE(registry.GetCount() == 5);
+            const size_t index = registry.GetIndex(handles[3]);
+            CHECK(*registry.GetId(index) == 3);
+            CHECK(registry.GetName(index) == "Dog 3"s);
+            CHECK(registry.GetSpeed(index) == geom::Vec2D{0.0, 3.0});
+            CHECK(registry.GetBagContent(index).size() == 3);
+            CHECK(registry.IsBagFull(index));
+            CHECK(!registry.PutToBag(index, {FoundObject::Id{1}, 1u}));
+        }
+
+        WHEN("a dog is removed") {
+            registry.Remove(handles[1]);
+
+            THEN("its handle becomes invalid and the others keep their data") {
+                CHECK(registry.GetCount() == 4);
+                CHECK(!registry.IsValid(handles[1]));
+                CHECK_THROWS_AS(registry.GetIndex(handles[1]), std::invalid_argument);
+                for (uint32_t id : {0u, 2u, 3u, 4u}) {
+                    const size_t index = registry.GetIndex(handles[id]);
+                    CHECK(*registry.GetId(index) == id);
+                    CHECK(registry.GetPosition(index) == geom::Point2D{id * 1.0, 0.0});
+                    CHECK(registry.GetScore(index) == id * 10);
+                    REQUIRE(registry.GetBagContent(index).size() == id % 4);
+                    for (uint32_t i = 0; i < id % 4; ++i) {
+                        CHECK(registry.GetBagContent(index)[i] == FoundObject{FoundObject::Id{id * 100 + i}, i});
+                    }
+                }
+            }
+
+            AND_WHEN("a new dog takes the freed slot") {
+                const auto handle = registry.Add(Dog::Id{42}, "New"s, {});
+
+                THEN("the old handle still does not match it") {
+                    CHECK(handle.slot == handles[1].slot);
+                    CHECK(!registry.IsValid(handles[1]));
+                    CHECK(registry.IsValid(handle));
+                    CHECK(registry.GetBagContent(registry.GetIndex(handle)).empty());
+                }
+            }
+        }
+
+        WHEN("dogs are converted to Dog and back") {
+            std::vector<DogPtr> dogs;
+            DogRegistry copy{3};
+            for (size_t i = 0; i < registry.GetCount(); ++i) {
+                dogs.push_back(std::make_shared<Dog>(registry.MakeDog(i)));
+                copy.Add(*dogs.back());
+            }
+
+            THEN("the state is preserved") {
+                std::vector<Dog> restored;
+                for (size_t i = 0; i < copy.GetCount(); ++i) {
+                    restored.push_back(copy.MakeDog(i));
+                }
+                CheckSameDogs(dogs, restored);
+            }
+        }
+    }
+}
+
+SCENARIO("Movement integration") {
+    GIVEN("dogs inside their roads") {
+        DogRegistry registry{1};
+        registry.Add(Dog::Id{0}, "a"s, {1.0, 0.0});
+        registry.Add(Dog::Id{1}, "b"s, {1.0, 0.0});
+        registry.Add(Dog::Id{2}, "c"s, {0.0, 0.5});
+        registry.SetSpeed(0, {2.0, 0.0});
+        registry.SetSpeed(1, {10.0, 0.0});
+        registry.SetSpeed(2, {0.0, -4.0});
+        const std::vector<double> min_x{-0.4, -0.4, -0.4}, max_x{10.4, 5.4, 0.4};
+        const std::vector<double> min_y{-0.4, -0.4, -0.4}, max_y{0.4, 0.4, 10.4};
+
+        WHEN("a tick passes") {
+            IntegrateMovement(registry.GetMovementColumns(), {min_x, min_y, max_x, max_y}, 0.5);
+
+            THEN("dogs move and those reaching the border stop there") {
+                CHECK(registry.GetPosition(0) == geom::Point2D{2.0, 0.0});
+                CHECK(registry.GetSpeed(0) == geom::Vec2D{2.0, 0.0});
+                CHECK(registry.GetPosition(1) == geom::Point2D{5.4, 0.0});
+                CHECK(registry.GetSpeed(1) == geom::Vec2D{});
+                CHECK(registry.GetPosition(2) == geom::Point2D{0.0, -0.4});
+                CHECK(registry.GetSpeed(2) == geom::Vec2D{});
+            }
+        }
+    }
+
+    GIVEN("random dogs and bounds") {
+        std::mt19937 random{17};
+        std::uniform_real_distribution<double> coord{-100.0, 100.0};
+        std::uniform_real_distribution<double> speed{-50.0, 50.0};
+        std::uniform_real_distribution<double> size{0.0, 20.0};
+
+        THEN("the AVX2 kernel matches the scalar one bit for bit") {
+            for (size_t count : {0, 1, 3, 4, 7, 100, 1001}) {
+                std::vector<double> x(count), y(count), speed_x(count), speed_y(count);
+                std::vector<double> min_x(count), min_y(count), max_x(count), max_y(count);
+                for (size_t i = 0; i < count; ++i) {
+                    x[i] = coord(random);
+                    y[i] = coord(random);
+                    // Часть собак стоит, часть стоит ровно на границе
+                    speed_x[i] = i % 5 == 0 ? 0.0 : speed(random);
+                    speed_y[i] = i % 3 == 0 ? 0.0 : speed(random);
+                    min_x[i] = i % 7 == 0 ? x[i] : x[i] - size(random);
+                    min_y[i] = y[i] - size(random);
+                    max_x[i] = x[i] + size(random);
+                    max_y[i] = i % 11 == 0 ? y[i] : y[i] + size(random);
+                }
+                auto x2 = x, y2 = y, speed_x2 = speed_x, speed_y2 = speed_y;
+                const MovementBounds bounds{min_x, min_y, max_x, max_y};
+
+                detail::IntegrateMovementScalar({x, y, speed_x, speed_y}, bounds, 0.1);
+                if (detail::HasAvx2()) {
+                    detail::IntegrateMovementAvx2({x2, y2, speed_x2, speed_y2}, bounds, 0.1);
+                } else {
+                    detail::IntegrateMovementScalar({x2, y2, speed_x2, speed_y2}, bounds, 0.1);
+                }
+                // Побитовое сравнение: NaN равен себе, а 0.0 и -0.0 различаются
+                const auto same_bits = [](const std::vector<double>& lhs, const std::vector<double>& rhs) {
+                    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](double l, double r) {
+                        return std::bit_cast<uint64_t>(l) == std::bit_cast<uint64_t>(r);
+                    });
+                };
+                CHECK(same_bits(x, x2));
+                CHECK(same_bits(y, y2));
+                CHECK(same_bits(speed_x, speed_x2));
+                CHECK(same_bits(speed_y, speed_y2));
+            }
+        }
+    }
+}